@@ -0,0 +1,418 @@
+// Controller microbenchmark.
+// Compares cars per second for the fuzzy engine, the flat kernel and each batch kernel
+// the processor supports, and checks every evaluator against the engine. Also compares the
+// closed form ExactCentroid against fl::Centroid sampled at several resolutions, times sparse
+// against full rule evaluation on rule bases of growing size, and reports how many controller
+// evaluations each integrator needs per simulated second to track the car to a given accuracy.
+//
+// Usage:
+//		benchmark [--cars n] [--engine-cars n] [--seed n] [--accuracy a] [--duration s]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../source/Controller/batch_controller.h"
+#include "../source/Controller/engine_controller.h"
+#include "../source/Controller/flat_controller.h"
+#include "../source/Simulation/integrator.h"
+#include "../source/Simulation/simulator.h"
+
+namespace
+{
+	struct Options
+	{
+		std::size_t cars = 1000000;
+		// fl::Engine::process() is orders of magnitude slower, so it runs on a prefix of the cars.
+		std::size_t engine_cars = 20000;
+		unsigned seed = 1203086;
+		// Largest displacement or velocity error allowed at any checkpoint of the integrator runs.
+		double accuracy = 1e-3;
+		// Simulated seconds per integrator run.
+		double duration = 10.0;
+	};
+
+	// Integrator runs are compared at checkpoints this far apart.
+	const double kCheckpointInterval = 0.5;
+	// Evaluations per rule base when comparing sparse and full rule evaluation.
+	const std::size_t kRuleBaseCars = 200000;
+
+	bool ParseOptions(int _argc, char** _argv, Options& _options)
+	{
+		for (int i = 1; i < _argc; ++i)
+		{
+			const std::string arg(_argv[i]);
+			if (arg == "--cars" && i + 1 < _argc)
+			{
+				_options.cars = static_cast<std::size_t>(std::atol(_argv[++i]));
+			}
+			else if (arg == "--engine-cars" && i + 1 < _argc)
+			{
+				_options.engine_cars = static_cast<std::size_t>(std::atol(_argv[++i]));
+			}
+			else if (arg == "--seed" && i + 1 < _argc)
+			{
+				_options.seed = static_cast<unsigned>(std::atol(_argv[++i]));
+			}
+			else if (arg == "--accuracy" && i + 1 < _argc)
+			{
+				_options.accuracy = std::atof(_argv[++i]);
+			}
+			else if (arg == "--duration" && i + 1 < _argc)
+			{
+				_options.duration = std::atof(_argv[++i]);
+			}
+			else
+			{
+				std::cerr << "Usage: benchmark [--cars n] [--engine-cars n] [--seed n] [--accuracy a] [--duration s]\n";
+				return false;
+			}
+		}
+		_options.engine_cars = std::min(std::max<std::size_t>(_options.engine_cars, 1), _options.cars);
+		return _options.cars > 0 && _options.accuracy > 0.0 && _options.duration >= kCheckpointInterval;
+	}
+
+	template<typename Function>
+	double Seconds(Function _function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		_function();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	double MaxDifference(const std::vector<double>& _a, const std::vector<double>& _b, std::size_t _count)
+	{
+		double difference = 0.0;
+		for (std::size_t i = 0; i < _count; ++i)
+		{
+			difference = std::max(difference, std::abs(_a[i] - _b[i]));
+		}
+		return difference;
+	}
+
+	void Report(const std::string& _name, std::size_t _cars, double _seconds, double _baseline, double _error)
+	{
+		const double rate = _cars / _seconds;
+		std::cout.precision(4);
+		std::cout << _name << ": " << rate << " cars/s";
+		if (_baseline > 0.0)
+		{
+			std::cout << " (" << rate / _baseline << "x engine, max error " << _error << ")";
+		}
+		std::cout << std::endl;
+	}
+
+	double MaxStateDifference(const std::vector<car::CarState>& _a, const std::vector<car::CarState>& _b)
+	{
+		double difference = 0.0;
+		for (std::size_t i = 0; i < _a.size(); ++i)
+		{
+			difference = std::max(difference, std::abs(_a[i].displacement - _b[i].displacement));
+			difference = std::max(difference, std::abs(_a[i].velocity - _b[i].velocity));
+		}
+		return difference;
+	}
+
+	// BuildPartitionEngine
+	// Engine with _inputs inputs, each split into _terms evenly spaced overlapping terms (ramps at
+	// both ends, triangles between), and one rule per combination of input terms steering against
+	// their mean, so the rule base grows as _terms to the power of _inputs like a finer car controller.
+	// OUT:		Engine owned by the caller
+	fl::Engine* BuildPartitionEngine(int _terms, int _inputs)
+	{
+		fl::Engine* engine = new fl::Engine("Partition " + std::to_string(_terms) + "^" + std::to_string(_inputs));
+		const double width = 2.0 / (_terms - 1);
+		auto add_terms = [_terms, width](fl::Variable* _variable)
+		{
+			for (int t = 0; t < _terms; ++t)
+			{
+				const double centre = -1.0 + t * width;
+				const std::string name = "T" + std::to_string(t);
+				if (t == 0)
+				{
+					_variable->addTerm(new fl::Ramp(name, centre + width, centre));
+				}
+				else if (t == _terms - 1)
+				{
+					_variable->addTerm(new fl::Ramp(name, centre - width, centre));
+				}
+				else
+				{
+					_variable->addTerm(new fl::Triangle(name, centre - width, centre, centre + width));
+				}
+			}
+		};
+		for (int i = 0; i < _inputs; ++i)
+		{
+			fl::InputVariable* input = new fl::InputVariable("x" + std::to_string(i), -1.0, 1.0);
+			add_terms(input);
+			engine->addInputVariable(input);
+		}
+		fl::OutputVariable* output = new fl::OutputVariable("y", -1.0, 1.0);
+		add_terms(output);
+		engine->addOutputVariable(output);
+
+		fl::RuleBlock* rule_block = new fl::RuleBlock;
+		std::vector<int> terms(_inputs, 0);
+		for (bool done = false; !done; )
+		{
+			std::string rule = "if ";
+			int sum = 0;
+			for (int i = 0; i < _inputs; ++i)
+			{
+				rule += (i > 0 ? " and x" : "x") + std::to_string(i) + " is T" + std::to_string(terms[i]);
+				sum += terms[i];
+			}
+			const long conclusion = std::lround((_terms - 1) - static_cast<double>(sum) / _inputs);
+			rule += " then y is T" + std::to_string(conclusion);
+			rule_block->addRule(fl::Rule::parse(rule, engine));
+
+			int i = 0;
+			while (i < _inputs && ++terms[i] == _terms)
+			{
+				terms[i++] = 0;
+			}
+			done = i == _inputs;
+		}
+		engine->addRuleBlock(rule_block);
+		car::ExactCentroid::Register();
+		engine->configure("Minimum", "", "Minimum", "Maximum", "ExactCentroid");
+		return engine;
+	}
+
+	// Checkpoints
+	// Runs each initial state, with a fresh copy of _integrator, for _checkpoints intervals of
+	// kCheckpointInterval with _sub_steps calls to Advance() per interval.
+	// OUT:		States at every checkpoint (trajectory major) and the controller evaluations made
+	std::vector<car::CarState> Checkpoints(const car::Integrator& _integrator, car::SteeringController& _controller,
+										   const std::vector<car::CarState>& _initial, int _checkpoints, int _sub_steps,
+										   std::size_t& _evaluations)
+	{
+		_evaluations = 0;
+		std::vector<car::CarState> states;
+		const double step = kCheckpointInterval / _sub_steps;
+		for (const car::CarState& initial : _initial)
+		{
+			std::unique_ptr<car::Integrator> integrator(_integrator.Clone());
+			car::CarState state = car::Simulator::Initialize(_controller, initial.displacement, initial.velocity);
+			for (int checkpoint = 0; checkpoint < _checkpoints; ++checkpoint)
+			{
+				for (int sub_step = 0; sub_step < _sub_steps; ++sub_step)
+				{
+					state = integrator->Advance(_controller, state, step);
+				}
+				states.push_back(state);
+			}
+			_evaluations += integrator->GetEvaluations();
+		}
+		return states;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<car::EngineController> engine;
+	car::FlatController flat;
+	try
+	{
+		engine.reset(new car::EngineController(car::BuildCarEngine()));
+	}
+	catch (const fl::Exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::string status;
+	if (!flat.Compile(*engine->GetEngine(), &status))
+	{
+		std::cerr << "Failed to compile flat controller:\n" << status;
+		return EXIT_FAILURE;
+	}
+
+	// Inputs cover the universe plus a margin, where the outer terms saturate.
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<double> distribution(-1.2, 1.2);
+	std::vector<double> displacement(options.cars), velocity(options.cars);
+	for (std::size_t i = 0; i < options.cars; ++i)
+	{
+		displacement[i] = distribution(random);
+		velocity[i] = distribution(random);
+	}
+
+	std::vector<double> reference(options.engine_cars);
+	const double engine_seconds = Seconds([&]()
+	{
+		for (std::size_t i = 0; i < options.engine_cars; ++i)
+		{
+			reference[i] = engine->Steering(displacement[i], velocity[i]);
+		}
+	});
+	const double engine_rate = options.engine_cars / engine_seconds;
+	Report("fl::Engine::process (ExactCentroid)", options.engine_cars, engine_seconds, 0.0, 0.0);
+
+	std::vector<double> steering(options.cars);
+	const double flat_seconds = Seconds([&]()
+	{
+		for (std::size_t i = 0; i < options.cars; ++i)
+		{
+			steering[i] = flat.Steering(displacement[i], velocity[i]);
+		}
+	});
+	Report("FlatController", options.cars, flat_seconds, engine_rate, MaxDifference(steering, reference, options.engine_cars));
+	const std::vector<double> exact = steering;
+
+	// Sampled Centroid at each resolution, with errors measured against the exact centroid.
+	for (int resolution : { 100, 200, 1000 })
+	{
+		const std::string name = "Centroid " + std::to_string(resolution);
+		car::EngineController sampled(engine->GetEngine()->clone());
+		sampled.GetEngine()->getOutputVariable(0)->setDefuzzifier(new fl::Centroid(resolution));
+
+		std::vector<double> sampled_steering(options.cars);
+		const double sampled_seconds = Seconds([&]()
+		{
+			for (std::size_t i = 0; i < options.engine_cars; ++i)
+			{
+				sampled_steering[i] = sampled.Steering(displacement[i], velocity[i]);
+			}
+		});
+		Report("fl::Engine::process (" + name + ")", options.engine_cars, sampled_seconds, engine_rate,
+			   MaxDifference(sampled_steering, reference, options.engine_cars));
+
+		car::FlatController sampled_flat;
+		sampled_flat.Compile(*sampled.GetEngine());
+		const double sampled_flat_seconds = Seconds([&]()
+		{
+			for (std::size_t i = 0; i < options.cars; ++i)
+			{
+				sampled_steering[i] = sampled_flat.Steering(displacement[i], velocity[i]);
+			}
+		});
+		Report("FlatController (" + name + ")", options.cars, sampled_flat_seconds, engine_rate,
+			   MaxDifference(sampled_steering, exact, options.cars));
+	}
+
+	car::BatchController batch(flat);
+	const car::BatchController::ISA best = car::BatchController::DetectISA();
+	for (int isa = static_cast<int>(car::BatchController::ISA::SCALAR); isa <= static_cast<int>(best); ++isa)
+	{
+		batch.SetISA(static_cast<car::BatchController::ISA>(isa));
+		std::fill(steering.begin(), steering.end(), 0.0);
+		const double batch_seconds = Seconds([&]()
+		{
+			batch.Steering(displacement.data(), velocity.data(), steering.data(), options.cars);
+		});
+		Report(std::string("BatchController ") + car::BatchController::ISAName(batch.GetISA()),
+			   options.cars, batch_seconds, engine_rate, MaxDifference(steering, reference, options.engine_cars));
+	}
+
+	// Rule bases: every rule against only those whose antecedent can be non-zero. Results are
+	// identical, so the difference is reported as a check rather than an error.
+	std::cout << "\nRule bases (full / sparse rule evaluation)" << std::endl;
+	for (int inputs : { 2, 3 })
+	{
+		for (int terms : { 5, 7, 9 })
+		{
+			std::unique_ptr<fl::Engine> partition(BuildPartitionEngine(terms, inputs));
+			car::FlatController compiled;
+			if (!compiled.Compile(*partition, &status))
+			{
+				std::cerr << "Failed to compile " << partition->getName() << ":\n" << status;
+				return EXIT_FAILURE;
+			}
+			const std::size_t cars = std::min(options.cars, kRuleBaseCars);
+			std::vector<double> values(cars * inputs);
+			for (double& value : values)
+			{
+				value = distribution(random);
+			}
+			std::vector<double> full(cars), sparse(cars);
+			compiled.SetSparse(false);
+			const double full_seconds = Seconds([&]()
+			{
+				for (std::size_t i = 0; i < cars; ++i)
+				{
+					full[i] = compiled.Evaluate(&values[i * inputs]);
+				}
+			});
+			compiled.SetSparse(true);
+			const double sparse_seconds = Seconds([&]()
+			{
+				for (std::size_t i = 0; i < cars; ++i)
+				{
+					sparse[i] = compiled.Evaluate(&values[i * inputs]);
+				}
+			});
+			std::cout << terms;
+			for (int i = 1; i < inputs; ++i)
+			{
+				std::cout << "x" << terms;
+			}
+			std::cout << " (" << compiled.GetRuleCount() << " rules): " << cars / full_seconds << " / " << cars / sparse_seconds
+					  << " evaluations/s (" << full_seconds / sparse_seconds << "x, max difference "
+					  << MaxDifference(full, sparse, cars) << ")" << std::endl;
+		}
+	}
+
+	// Integrators: the cheapest setting of each that keeps every checkpoint within the accuracy
+	// of a reference run, in controller evaluations per simulated second of one car.
+	// Steering jumps by around macheps where a rule starts to fire, which caps every method at
+	// first order near those points; the reference tolerance sits well below the default accuracy
+	// but above where those jumps and rounding dominate.
+	std::cout << "\nIntegrators (accuracy " << options.accuracy << " over " << options.duration << " s)" << std::endl;
+	const std::vector<car::CarState> initial = car::Simulator::Grid(-1.0, 1.0, 3, -1.0, 1.0, 3);
+	const int checkpoints = static_cast<int>(options.duration / kCheckpointInterval);
+	const double simulated = initial.size() * checkpoints * kCheckpointInterval;
+	std::size_t evaluations = 0;
+	const std::vector<car::CarState> exact_states = Checkpoints(car::RK45Integrator(1e-10), flat, initial, checkpoints, 1, evaluations);
+
+	for (car::INTEGRATION method : { car::INTEGRATION::EULER, car::INTEGRATION::SEMI_IMPLICIT_EULER, car::INTEGRATION::RK4 })
+	{
+		std::unique_ptr<car::Integrator> integrator(car::CreateIntegrator(method));
+		bool reached = false;
+		for (int sub_steps = 1; sub_steps <= (1 << 14) && !reached; sub_steps *= 2)
+		{
+			const double error = MaxStateDifference(Checkpoints(*integrator, flat, initial, checkpoints, sub_steps, evaluations), exact_states);
+			if (error <= options.accuracy)
+			{
+				reached = true;
+				std::cout << integrator->GetName() << ": timestep " << kCheckpointInterval / sub_steps << ", "
+						  << evaluations / simulated << " evaluations per simulated second (error " << error << ")" << std::endl;
+			}
+		}
+		if (!reached)
+		{
+			std::cout << integrator->GetName() << ": accuracy not reached" << std::endl;
+		}
+	}
+
+	bool reached = false;
+	for (double tolerance = 1e-2; tolerance >= 1e-10 && !reached; tolerance *= 0.1)
+	{
+		const double error = MaxStateDifference(Checkpoints(car::RK45Integrator(tolerance), flat, initial, checkpoints, 1, evaluations), exact_states);
+		if (error <= options.accuracy)
+		{
+			reached = true;
+			std::cout << "RK45: tolerance " << tolerance << ", "
+					  << evaluations / simulated << " evaluations per simulated second (error " << error << ")" << std::endl;
+		}
+	}
+	if (!reached)
+	{
+		std::cout << "RK45: accuracy not reached" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
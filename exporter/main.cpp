@@ -0,0 +1,174 @@
+// Control surface exporter.
+// Samples the fuzzy controller on a regular grid on every core and writes the steering surface,
+// the most active rule at each point and per-rule activation maps to a binary file.
+//
+// Usage:
+//		exporter output [--size n] [--displacement min max] [--velocity min max] [--threads n]
+//				 [--no-rule-maps] [--csv path] [--decimals n] [--fld path]
+//
+// --csv		Also write "input,input,output[,rule...]" rows as text, headed by the engine's variable names
+// --fld		Also export with fl::FldExporter (serial, string formatted) for comparison
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../source/Controller/engine_controller.h"
+#include "../source/Export/surface_map.h"
+
+namespace
+{
+	struct Options
+	{
+		std::string output;
+		car::SurfaceMapSettings settings;
+		std::string csv;
+		int decimals = fl::fuzzylite::decimals();
+		std::string fld;
+	};
+
+	void PrintUsage()
+	{
+		std::cerr << "Usage: exporter output [--size n] [--displacement min max] [--velocity min max] [--threads n]\n"
+					 "                [--no-rule-maps] [--csv path] [--decimals n] [--fld path]\n";
+	}
+
+	bool ParseOptions(int _argc, char** _argv, Options& _options)
+	{
+		for (int i = 1; i < _argc; ++i)
+		{
+			const std::string arg(_argv[i]);
+			const int remaining = _argc - i - 1;
+			if (arg == "--size" && remaining >= 1)
+			{
+				_options.settings.displacement_count = _options.settings.velocity_count = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--displacement" && remaining >= 2)
+			{
+				_options.settings.displacement_min = std::atof(_argv[++i]);
+				_options.settings.displacement_max = std::atof(_argv[++i]);
+			}
+			else if (arg == "--velocity" && remaining >= 2)
+			{
+				_options.settings.velocity_min = std::atof(_argv[++i]);
+				_options.settings.velocity_max = std::atof(_argv[++i]);
+			}
+			else if (arg == "--threads" && remaining >= 1)
+			{
+				_options.settings.threads = static_cast<unsigned>(std::atoi(_argv[++i]));
+			}
+			else if (arg == "--no-rule-maps")
+			{
+				_options.settings.rule_maps = false;
+			}
+			else if (arg == "--csv" && remaining >= 1)
+			{
+				_options.csv = _argv[++i];
+			}
+			else if (arg == "--decimals" && remaining >= 1)
+			{
+				_options.decimals = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--fld" && remaining >= 1)
+			{
+				_options.fld = _argv[++i];
+			}
+			else if (_options.output.empty() && arg.compare(0, 2, "--") != 0)
+			{
+				_options.output = arg;
+			}
+			else
+			{
+				std::cerr << "Unrecognised or incomplete argument: " << arg << "\n";
+				return false;
+			}
+		}
+		return !_options.output.empty() && _options.decimals >= 0;
+	}
+
+	double Seconds(std::chrono::steady_clock::time_point _start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<fl::Engine> engine;
+	try
+	{
+		engine.reset(car::BuildCarEngine());
+	}
+	catch (const fl::Exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	car::SurfaceMap map;
+	std::string status;
+	auto start = std::chrono::steady_clock::now();
+	if (!map.Build(*engine, options.settings, &status))
+	{
+		std::cerr << "Failed to build the surface:\n" << status;
+		return EXIT_FAILURE;
+	}
+	const double points = static_cast<double>(map.GetDisplacementCount()) * map.GetVelocityCount();
+	std::cerr << map.GetDisplacementCount() << "x" << map.GetVelocityCount() << " surface, " << map.GetRuleCount()
+			  << " rules evaluated in " << Seconds(start) << " s" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	if (!map.Save(options.output))
+	{
+		std::cerr << "Failed to write " << options.output << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cerr << "Binary written to " << options.output << " in " << Seconds(start) << " s" << std::endl;
+
+	if (!options.csv.empty())
+	{
+		start = std::chrono::steady_clock::now();
+		if (!map.SaveCsv(options.csv, options.decimals))
+		{
+			std::cerr << "Failed to write " << options.csv << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cerr << "CSV written to " << options.csv << " in " << Seconds(start) << " s" << std::endl;
+	}
+
+	if (!options.fld.empty())
+	{
+		start = std::chrono::steady_clock::now();
+		try
+		{
+			fl::FldExporter exporter(",");
+			exporter.toFile(options.fld, engine.get(), static_cast<int>(points));
+		}
+		catch (const fl::Exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cerr << "fl::FldExporter wrote " << options.fld << " in " << Seconds(start) << " s" << std::endl;
+	}
+
+	// Which rules dominate the surface.
+	const std::vector<double> shares = map.DominanceShares();
+	std::cout << "rule,dominant_share\n";
+	for (int r = 0; r < map.GetRuleCount(); ++r)
+	{
+		std::cout << '"' << map.GetRuleText(r) << "\"," << std::fixed << std::setprecision(4) << shares[r] << '\n';
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,400 @@
+#include "file_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+namespace agn
+{
+	// Definitions for the in-class constants, which std::min() binds by reference.
+	const std::size_t FileLog::kMaxText;
+	const int FileLog::kMaxValues;
+
+	namespace
+	{
+		// Longest the writer sleeps before checking the ring again. A producer's wake up can be
+		// missed in the instant the writer starts waiting, which delays a record by at most this.
+		const std::chrono::milliseconds kIdleWait(10);
+		// Buffered output is flushed to disk at least this often while records keep arriving.
+		const std::chrono::milliseconds kFlushInterval(100);
+
+		const char* LevelPrefix(FileLog::LEVEL _level)
+		{
+			switch (_level)
+			{
+			case FileLog::LEVEL::FATAL_ERROR:	return "<FATAL ERROR> ";
+			case FileLog::LEVEL::ERROR_MESSAGE:	return "<ERROR> ";
+			case FileLog::LEVEL::WARNING:		return "<WARNING> ";
+			case FileLog::LEVEL::IMPORTANT:		return "<Important> ";
+			case FileLog::LEVEL::DIAGNOSTIC:	return "<Diagnostic> ";
+			default:							return "";
+			}
+		}
+
+		std::size_t RoundUpToPowerOfTwo(std::size_t _value)
+		{
+			std::size_t power = 2;
+			while (power < _value)
+			{
+				power <<= 1;
+			}
+			return power;
+		}
+	}
+
+	FileLog::FileLog() :
+		mask_(0),
+		full_policy_(FULL_POLICY::DROP),
+		enqueue_position_(0),
+		dequeue_position_(0),
+		dropped_(0),
+		written_(0),
+		writer_waiting_(false),
+		flush_requested_(false),
+		stopping_(false),
+		open_(false),
+		file_(nullptr),
+		file_size_(0),
+		max_file_size_(0),
+		max_files_(0),
+		dropped_reported_(0),
+		cached_second_(-1)
+	{
+		cached_stamp_[0] = '\0';
+	}
+
+	FileLog::~FileLog()
+	{
+		Close();
+	}
+
+	bool FileLog::Open(const std::string& _file_name, const Settings& _settings)
+	{
+		Close();
+
+		file_ = std::fopen(_file_name.c_str(), "ab");
+		if (!file_)
+		{
+			return false;
+		}
+		std::fseek(file_, 0, SEEK_END);
+		const long size = std::ftell(file_);
+		file_size_ = size > 0 ? static_cast<std::uint64_t>(size) : 0;
+		file_name_ = _file_name;
+		max_file_size_ = _settings.max_file_size;
+		max_files_ = _settings.max_files;
+
+		const std::size_t capacity = RoundUpToPowerOfTwo(std::max<std::size_t>(_settings.capacity, 2));
+		slots_.reset(new Slot[capacity]);
+		for (std::size_t i = 0; i < capacity; ++i)
+		{
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		mask_ = capacity - 1;
+		full_policy_ = _settings.full_policy;
+		enqueue_position_.store(0, std::memory_order_relaxed);
+		dequeue_position_ = 0;
+		dropped_.store(0, std::memory_order_relaxed);
+		written_.store(0, std::memory_order_relaxed);
+		dropped_reported_ = 0;
+		cached_second_ = -1;
+		flush_requested_ = false;
+		stopping_ = false;
+		open_ = true;
+		writer_ = std::thread(&FileLog::WriterLoop, this);
+		return true;
+	}
+
+	void FileLog::Close()
+	{
+		if (!open_)
+		{
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		condition_.notify_all();
+		writer_.join();
+
+		if (file_)
+		{
+			std::fclose(file_);
+			file_ = nullptr;
+		}
+		slots_.reset();
+		open_ = false;
+	}
+
+	bool FileLog::Push(LEVEL _level, const char* _text, std::size_t _length)
+	{
+		Slot* slot = Claim(_level);
+		if (!slot)
+		{
+			return false;
+		}
+		slot->label = nullptr;
+		slot->value_count = 0;
+		slot->length = std::min(_length, kMaxText);
+		std::memcpy(slot->text, _text, slot->length);
+		Publish(slot);
+		return true;
+	}
+
+	bool FileLog::Push(LEVEL _level, const char* _label, const double* _values, int _count)
+	{
+		Slot* slot = Claim(_level);
+		if (!slot)
+		{
+			return false;
+		}
+		slot->label = _label;
+		slot->value_count = std::min(std::max(_count, 0), kMaxValues);
+		std::copy(_values, _values + slot->value_count, slot->values);
+		slot->length = 0;
+		Publish(slot);
+		return true;
+	}
+
+	void FileLog::Flush()
+	{
+		if (!open_)
+		{
+			return;
+		}
+		const std::uint64_t target = enqueue_position_.load(std::memory_order_acquire);
+		std::unique_lock<std::mutex> lock(mutex_);
+		// Dropped records never claim a position, so every position below the target gets written.
+		while (written_.load(std::memory_order_acquire) < target)
+		{
+			condition_.notify_all();
+			condition_.wait_for(lock, std::chrono::milliseconds(1));
+		}
+		flush_requested_ = true;
+		while (flush_requested_)
+		{
+			condition_.notify_all();
+			condition_.wait_for(lock, std::chrono::milliseconds(1));
+		}
+	}
+
+	FileLog::Slot* FileLog::Claim(LEVEL _level)
+	{
+		std::uint64_t position = enqueue_position_.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot& slot = slots_[position & mask_];
+			const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const std::int64_t difference = static_cast<std::int64_t>(sequence - position);
+			if (difference == 0)
+			{
+				if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					slot.level = _level;
+					slot.time = std::chrono::duration_cast<std::chrono::microseconds>(
+						std::chrono::system_clock::now().time_since_epoch()).count();
+					return &slot;
+				}
+			}
+			else if (difference < 0)
+			{
+				// Full: the slot still holds a record from one lap ago.
+				if (full_policy_ == FULL_POLICY::DROP)
+				{
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				if (writer_waiting_.load(std::memory_order_relaxed))
+				{
+					condition_.notify_one();
+				}
+				std::this_thread::yield();
+				position = enqueue_position_.load(std::memory_order_relaxed);
+			}
+			else
+			{
+				position = enqueue_position_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void FileLog::Publish(Slot* _slot)
+	{
+		const std::uint64_t position = _slot->sequence.load(std::memory_order_relaxed);
+		_slot->sequence.store(position + 1, std::memory_order_release);
+		if (writer_waiting_.load(std::memory_order_relaxed))
+		{
+			condition_.notify_one();
+		}
+	}
+
+	void FileLog::WriterLoop()
+	{
+		auto last_flush = std::chrono::steady_clock::now();
+		for (;;)
+		{
+			const std::size_t written = Drain();
+
+			const auto now = std::chrono::steady_clock::now();
+			if (file_ && written > 0 && now - last_flush >= kFlushInterval)
+			{
+				std::fflush(file_);
+				last_flush = now;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (flush_requested_)
+			{
+				// Flush() only asks once everything it waits for has been written.
+				if (file_)
+				{
+					std::fflush(file_);
+				}
+				last_flush = now;
+				flush_requested_ = false;
+				condition_.notify_all();
+			}
+			if (stopping_)
+			{
+				lock.unlock();
+				Drain();
+				if (file_)
+				{
+					std::fflush(file_);
+				}
+				return;
+			}
+			if (written == 0)
+			{
+				writer_waiting_ = true;
+				condition_.wait_for(lock, kIdleWait);
+				writer_waiting_ = false;
+				if (file_ && std::chrono::steady_clock::now() - last_flush >= kFlushInterval)
+				{
+					lock.unlock();
+					std::fflush(file_);
+					last_flush = std::chrono::steady_clock::now();
+				}
+			}
+		}
+	}
+
+	std::size_t FileLog::Drain()
+	{
+		std::size_t written = 0;
+		for (;;)
+		{
+			Slot& slot = slots_[dequeue_position_ & mask_];
+			if (slot.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1)
+			{
+				break;
+			}
+			Write(slot);
+			slot.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+			++dequeue_position_;
+			++written;
+			written_.fetch_add(1, std::memory_order_release);
+		}
+
+		const std::uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+		if (dropped != dropped_reported_)
+		{
+			const int length = std::snprintf(line_, sizeof(line_), "%s<WARNING> %llu log records dropped, the log buffer was full.\n",
+											 TimeStamp(std::chrono::duration_cast<std::chrono::microseconds>(
+												 std::chrono::system_clock::now().time_since_epoch()).count()),
+											 static_cast<unsigned long long>(dropped - dropped_reported_));
+			WriteLine(line_, static_cast<std::size_t>(std::max(length, 0)));
+			dropped_reported_ = dropped;
+		}
+		return written;
+	}
+
+	void FileLog::Write(const Slot& _slot)
+	{
+		const char* stamp = TimeStamp(_slot.time);
+		const char* prefix = LevelPrefix(_slot.level);
+		std::size_t length = std::strlen(stamp);
+		std::memcpy(line_, stamp, length);
+		const std::size_t prefix_length = std::strlen(prefix);
+		std::memcpy(line_ + length, prefix, prefix_length);
+		length += prefix_length;
+
+		if (_slot.label)
+		{
+			const std::size_t label_length = std::min(std::strlen(_slot.label), kMaxText);
+			std::memcpy(line_ + length, _slot.label, label_length);
+			length += label_length;
+			for (int i = 0; i < _slot.value_count; ++i)
+			{
+				const int written = std::snprintf(line_ + length, sizeof(line_) - length, " %.9g", _slot.values[i]);
+				length += static_cast<std::size_t>(std::max(written, 0));
+			}
+		}
+		else
+		{
+			std::memcpy(line_ + length, _slot.text, _slot.length);
+			length += _slot.length;
+		}
+		line_[length++] = '\n';
+		WriteLine(line_, length);
+	}
+
+	void FileLog::WriteLine(const char* _line, std::size_t _length)
+	{
+		if (max_file_size_ > 0 && file_size_ > 0 && file_size_ + _length > max_file_size_)
+		{
+			Rotate();
+		}
+		if (file_)
+		{
+			std::fwrite(_line, 1, _length, file_);
+			file_size_ += _length;
+		}
+	}
+
+	const char* FileLog::TimeStamp(std::int64_t _time)
+	{
+		// localtime and strftime only run when the second changes.
+		const std::int64_t second = _time >= 0 ? _time / 1000000 : (_time - 999999) / 1000000;
+		const int milliseconds = static_cast<int>((_time - second * 1000000) / 1000);
+		if (second != cached_second_)
+		{
+			const std::time_t now = static_cast<std::time_t>(second);
+			std::tm local;
+#ifdef _WIN32
+			localtime_s(&local, &now);
+#else
+			localtime_r(&now, &local);
+#endif
+			std::strftime(cached_stamp_, sizeof(cached_stamp_), "[%Y-%m-%d %H:%M:%S.000] ", &local);
+			cached_second_ = second;
+		}
+		// Patch the milliseconds into "[YYYY-MM-DD HH:MM:SS.mmm] ".
+		cached_stamp_[21] = static_cast<char>('0' + milliseconds / 100);
+		cached_stamp_[22] = static_cast<char>('0' + milliseconds / 10 % 10);
+		cached_stamp_[23] = static_cast<char>('0' + milliseconds % 10);
+		return cached_stamp_;
+	}
+
+	void FileLog::Rotate()
+	{
+		if (file_)
+		{
+			std::fclose(file_);
+		}
+		if (max_files_ > 0)
+		{
+			// name.(n - 1) -> name.n, ..., name -> name.1. The oldest falls off the end.
+			std::remove((file_name_ + "." + std::to_string(max_files_)).c_str());
+			for (unsigned i = max_files_ - 1; i >= 1; --i)
+			{
+				std::rename((file_name_ + "." + std::to_string(i)).c_str(),
+							(file_name_ + "." + std::to_string(i + 1)).c_str());
+			}
+			std::rename(file_name_.c_str(), (file_name_ + ".1").c_str());
+		}
+		file_ = std::fopen(file_name_.c_str(), "wb");
+		file_size_ = 0;
+	}
+}
@@ -0,0 +1,136 @@
+#ifndef _AGNOSTIC_FILE_LOG_H_
+#define _AGNOSTIC_FILE_LOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace agn
+{
+	// FileLog
+	// Asynchronous file backend for Log. Callers copy a record into a fixed size slot of a
+	// lock-free ring buffer (bounded multi-producer queue, one sequence number per slot) and
+	// return; a background thread formats the records and writes them to a file that is
+	// rotated once it reaches a size limit. Pushing never allocates, locks or touches the file.
+	class FileLog
+	{
+	public:
+
+		enum class LEVEL { FATAL_ERROR, ERROR_MESSAGE, WARNING, IMPORTANT, MESSAGE, DIAGNOSTIC };
+
+		// What Push() does when every slot of the ring is taken.
+		// DROP discards the new record and counts it; the writer later logs how many were lost.
+		// BLOCK spins until the writer frees a slot, so nothing is lost but callers can stall.
+		enum class FULL_POLICY { DROP, BLOCK };
+
+		struct Settings
+		{
+			// Slots in the ring, rounded up to a power of two.
+			std::size_t capacity = 8192;
+			FULL_POLICY full_policy = FULL_POLICY::DROP;
+			// The file is rotated to name.1 (name.1 to name.2 and so on) when it reaches this size.
+			std::uint64_t max_file_size = 16 * 1024 * 1024;
+			// Rotated files kept besides the current one. Zero truncates the file instead.
+			unsigned max_files = 3;
+		};
+
+		// Longer text is truncated.
+		static const std::size_t kMaxText = 240;
+		static const int kMaxValues = 8;
+
+		FileLog();
+		~FileLog();
+
+		// Open
+		// Opens _file_name for appending and starts the writer thread. Closes any open log first.
+		// OUT:		False if the file cannot be opened
+		bool Open(const std::string& _file_name, const Settings& _settings);
+		inline bool Open(const std::string& _file_name) { return Open(_file_name, Settings()); }
+
+		// Close
+		// Writes every record pushed so far, stops the writer thread and closes the file.
+		void Close();
+
+		// Push
+		// Queues a text record.
+		// OUT:		False if the record was dropped because the ring was full
+		bool Push(LEVEL _level, const char* _text, std::size_t _length);
+
+		// Push
+		// Queues a label and up to kMaxValues numbers, formatted by the writer thread.
+		// _label must outlive the log (e.g. a string literal), only the pointer is queued.
+		bool Push(LEVEL _level, const char* _label, const double* _values, int _count);
+
+		// Flush
+		// Blocks until every record pushed before the call is written and flushed to disk.
+		void Flush();
+
+		inline bool IsOpen() const { return open_; }
+		inline std::uint64_t GetDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+
+		FileLog(const FileLog&);
+		FileLog& operator=(const FileLog&);
+
+		struct Slot
+		{
+			std::atomic<std::uint64_t> sequence;
+			LEVEL level;
+			// Microseconds since the system clock's epoch.
+			std::int64_t time;
+			const char* label;
+			int value_count;
+			double values[kMaxValues];
+			std::size_t length;
+			char text[kMaxText];
+		};
+
+		// Claims a slot for writing, or returns null if the ring is full and the policy is DROP.
+		Slot* Claim(LEVEL _level);
+		void Publish(Slot* _slot);
+
+		void WriterLoop();
+		// Formats and writes every published record. OUT: Number written
+		std::size_t Drain();
+		void Write(const Slot& _slot);
+		void WriteLine(const char* _line, std::size_t _length);
+		const char* TimeStamp(std::int64_t _time);
+		void Rotate();
+
+		std::unique_ptr<Slot[]> slots_;
+		std::size_t mask_;
+		FULL_POLICY full_policy_;
+		std::atomic<std::uint64_t> enqueue_position_;
+		std::uint64_t dequeue_position_;
+		std::atomic<std::uint64_t> dropped_;
+		std::atomic<std::uint64_t> written_;
+
+		std::thread writer_;
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		std::atomic<bool> writer_waiting_;
+		std::atomic<bool> flush_requested_;
+		bool stopping_;
+		bool open_;
+
+		// Writer thread only.
+		std::string file_name_;
+		std::FILE* file_;
+		std::uint64_t file_size_;
+		std::uint64_t max_file_size_;
+		unsigned max_files_;
+		std::uint64_t dropped_reported_;
+		std::int64_t cached_second_;
+		char cached_stamp_[32];
+		char line_[kMaxText + 512];
+	};
+}
+
+#endif // _AGNOSTIC_FILE_LOG_H_
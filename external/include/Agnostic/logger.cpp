@@ -7,4 +7,5 @@ namespace agn
 	bool Log::timestamps_ = false;
 	bool Log::log_to_file_ = false;
 	bool Log::log_to_console_ = true;
+	std::unique_ptr<FileLog> Log::file_log_;
 }
\ No newline at end of file
@@ -1,12 +1,19 @@
 #ifndef _AGNOSTIC_LOGGER_H_
 #define _AGNOSTIC_LOGGER_H_
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <Windows.h>
+#endif
 #include <iostream>
+#include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include "file_log.h"
 
 namespace agn
 {
@@ -16,13 +23,21 @@ namespace agn
 
 		// FatalError
 		// Use to log fatal errors to error stream.
-		static void FatalError(std::string _message)
+		static void FatalError(const std::string& _message)
 		{
-			if (timestamps_)
+			if (log_to_console_)
+			{
+				if (timestamps_)
+				{
+					std::cerr << TimeStamp();
+				}
+				std::cerr << "<FATAL ERROR> " << _message << std::endl;
+			}
+			if (file_log_)
 			{
-				std::cerr << TimeStamp().c_str();
+				file_log_->Push(FileLog::LEVEL::FATAL_ERROR, _message.data(), _message.size());
+				file_log_->Flush();
 			}
-			std::cerr << "<FATAL ERROR> " << _message.c_str() << std::endl;
 
 #ifdef _DEBUG
 			abort();
@@ -33,62 +48,148 @@ namespace agn
 
 		// Error
 		// Use to log non-fatal errors to error stream.
-		static void Error(std::string _message)
+		static void Error(const std::string& _message)
 		{
 			if (error_vebosity_ != ERRORVERBOSITY::FATAL_ERRORS_ONLY)
 			{
-				if (timestamps_)
+				if (log_to_console_)
+				{
+					if (timestamps_)
+					{
+						std::cerr << TimeStamp();
+					}
+					std::cerr << "<ERROR>" << _message << std::endl;
+				}
+				if (file_log_)
 				{
-					std::cerr << TimeStamp().c_str();
+					file_log_->Push(FileLog::LEVEL::ERROR_MESSAGE, _message.data(), _message.size());
 				}
-				std::cerr << "<ERROR>" << _message.c_str() << std::endl;
 			}
 		}
 
 		// Warning
 		// Use to log warnings to error stream.
-		static void Warning(std::string _message)
+		static void Warning(const std::string& _message)
 		{
 			if (error_vebosity_ == ERRORVERBOSITY::ALL)
 			{
-				if (timestamps_)
+				if (log_to_console_)
+				{
+					if (timestamps_)
+					{
+						std::cerr << TimeStamp();
+					}
+					std::cerr << "<WARNING> " << _message << std::endl;
+				}
+				if (file_log_)
 				{
-					std::cerr << TimeStamp().c_str();
+					file_log_->Push(FileLog::LEVEL::WARNING, _message.data(), _message.size());
 				}
-				std::cerr << "<WARNING> " << _message.c_str() << std::endl;
 			}
 		}
 
 		// Important
 		// Use to log important information to cout.
-		static void Important(std::string _message)
+		static void Important(const std::string& _message)
 		{
 			if (output_vebosity_ != OUTPUTVERBOSITY::NONE)
 			{
-				if (timestamps_)
+				if (log_to_console_)
+				{
+					if (timestamps_)
+					{
+						std::cout << TimeStamp();
+					}
+					std::cout << "<Important> " << _message << std::endl;
+				}
+				if (file_log_)
 				{
-					std::cout << TimeStamp().c_str();
+					file_log_->Push(FileLog::LEVEL::IMPORTANT, _message.data(), _message.size());
 				}
-				std::cout << "<Important> " << _message.c_str() << std::endl;
 			}
 		}
 
 		// Message
 		// Use to log information to cout.
-		static void Message(std::string _message)
+		static void Message(const std::string& _message)
 		{
 			if (output_vebosity_ == OUTPUTVERBOSITY::ALL)
 			{
-				if (timestamps_)
+				if (log_to_console_)
+				{
+					if (timestamps_)
+					{
+						std::cout << TimeStamp();
+					}
+					std::cout << _message << std::endl;
+				}
+				if (file_log_)
 				{
-					std::cout << TimeStamp().c_str();
+					file_log_->Push(FileLog::LEVEL::MESSAGE, _message.data(), _message.size());
 				}
-				std::cout << _message.c_str() << std::endl;
 			}
 		}
 
+		// Diagnostic
+		// Use to log a label and a few numbers, e.g. per step simulation state, to the log file only.
+		// Nothing is formatted on the calling thread and nothing is logged without a log file.
+		// _label must outlive the log file (e.g. a string literal).
+		static void Diagnostic(const char* _label, std::initializer_list<double> _values)
+		{
+			if (file_log_ && output_vebosity_ == OUTPUTVERBOSITY::ALL)
+			{
+				file_log_->Push(FileLog::LEVEL::DIAGNOSTIC, _label, _values.begin(), static_cast<int>(_values.size()));
+			}
+		}
+
+		// EnableFileLog
+		// Also writes every message to a rotating log file from a background thread.
+		// Call before any other thread starts logging.
+		// IN:		File name (appended to) and ring buffer, full buffer and rotation settings
+		// OUT:		False if the file cannot be opened
+		static bool EnableFileLog(const std::string& _file_name, const FileLog::Settings& _settings = FileLog::Settings())
+		{
+			std::unique_ptr<FileLog> file_log(new FileLog);
+			if (!file_log->Open(_file_name, _settings))
+			{
+				return false;
+			}
+			file_log_ = std::move(file_log);
+			log_to_file_ = true;
+			return true;
+		}
+
+		// DisableFileLog
+		// Writes out everything queued and closes the log file. Call once other threads stop logging.
+		static void DisableFileLog()
+		{
+			file_log_.reset();
+			log_to_file_ = false;
+		}
+
+		// FlushFileLog
+		// Blocks until everything logged so far is on disk.
+		static void FlushFileLog()
+		{
+			if (file_log_)
+			{
+				file_log_->Flush();
+			}
+		}
+
+		static void SetConsoleLogging(bool _enabled)
+		{
+			log_to_console_ = _enabled;
+		}
+
+		static void SetTimestamps(bool _enabled)
+		{
+			timestamps_ = _enabled;
+		}
+
 		static void EnableConsole()
 		{
+#ifdef _WIN32
 			// Allocate a console for this app.
 			AllocConsole();
 
@@ -101,6 +202,7 @@ namespace agn
 
 			// Redirect the C/C++ IO streams to the console.
 			BindIOToConsole();
+#endif
 		}
 
 	private:
@@ -108,8 +210,9 @@ namespace agn
 		static enum class ERRORVERBOSITY { ALL, ERRORS_ONLY, FATAL_ERRORS_ONLY } error_vebosity_;
 		static enum class OUTPUTVERBOSITY { ALL, IMPORTANT_ONLY, NONE } output_vebosity_;
 		static bool timestamps_;
-		static bool log_to_file_; // Log to file NYI
+		static bool log_to_file_;
 		static bool log_to_console_;
+		static std::unique_ptr<FileLog> file_log_;
 
 		static void BindIOToConsole()
 		{
@@ -131,12 +234,24 @@ namespace agn
 			std::cin.clear();
 		}
 
-		static std::string TimeStamp()
+		// Formatted once per second per thread.
+		static const char* TimeStamp()
 		{
-			std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-			char time[100];
-			std::strftime(time, sizeof(time), "[%x : %X] ", std::localtime(&now));
-			return(time);
+			static thread_local std::time_t cached_time = -1;
+			static thread_local char time[100];
+			const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+			if (now != cached_time)
+			{
+				std::tm local;
+#ifdef _WIN32
+				localtime_s(&local, &now);
+#else
+				localtime_r(&now, &local);
+#endif
+				std::strftime(time, sizeof(time), "[%x : %X] ", &local);
+				cached_time = now;
+			}
+			return time;
 		}
 	};
 }
@@ -0,0 +1,385 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace agn
+{
+	std::atomic<bool> Profiler::enabled_(false);
+
+	namespace
+	{
+		struct Totals
+		{
+			std::uint64_t calls = 0;
+			std::uint64_t total = 0;
+			std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+			std::uint64_t max = 0;
+		};
+
+		struct Event
+		{
+			int zone;
+			std::int64_t start;
+			std::int64_t duration;
+		};
+
+		// Written only by the thread it belongs to, read by reports while that thread is idle.
+		struct ThreadProfile
+		{
+			int id = 0;
+			std::string name;
+			// False once the thread has exited; the next new thread takes the profile over.
+			bool active = false;
+			std::vector<Totals> zones;
+			std::vector<std::uint64_t> counters;
+			std::vector<Event> events;
+			std::uint64_t dropped = 0;
+		};
+
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<const char*> zone_names;
+			std::vector<const char*> counter_names;
+			std::vector<std::unique_ptr<ThreadProfile>> threads;
+		};
+
+		Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		const std::chrono::steady_clock::time_point kEpoch = std::chrono::steady_clock::now();
+		std::atomic<std::size_t> trace_capacity(Profiler::kDefaultTraceCapacity);
+
+		// Hands the calling thread's profile back when the thread exits.
+		struct ThreadSlot
+		{
+			ThreadProfile* profile = nullptr;
+
+			~ThreadSlot()
+			{
+				if (profile)
+				{
+					std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+					profile->active = false;
+				}
+			}
+		};
+
+		thread_local ThreadSlot thread_slot;
+
+		ThreadProfile& CurrentThread()
+		{
+			if (!thread_slot.profile)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (auto& profile : registry.threads)
+				{
+					if (!profile->active)
+					{
+						thread_slot.profile = profile.get();
+						break;
+					}
+				}
+				if (!thread_slot.profile)
+				{
+					registry.threads.emplace_back(new ThreadProfile);
+					thread_slot.profile = registry.threads.back().get();
+					thread_slot.profile->id = static_cast<int>(registry.threads.size()) - 1;
+					thread_slot.profile->name = "Thread " + std::to_string(thread_slot.profile->id);
+				}
+				thread_slot.profile->active = true;
+			}
+			return *thread_slot.profile;
+		}
+
+		// Call sites sharing a name share an entry.
+		int Register(std::vector<const char*>& _names, const char* _name)
+		{
+			std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+			for (std::size_t i = 0; i < _names.size(); ++i)
+			{
+				if (std::strcmp(_names[i], _name) == 0)
+				{
+					return static_cast<int>(i);
+				}
+			}
+			_names.push_back(_name);
+			return static_cast<int>(_names.size()) - 1;
+		}
+
+		// Registry mutex must be held.
+		Profiler::ThreadStats Collect(const ThreadProfile& _profile, const Registry& _registry)
+		{
+			Profiler::ThreadStats stats;
+			stats.id = _profile.id;
+			stats.name = _profile.name;
+			for (std::size_t z = 0; z < _profile.zones.size(); ++z)
+			{
+				const Totals& totals = _profile.zones[z];
+				if (totals.calls > 0)
+				{
+					stats.zones.push_back({ _registry.zone_names[z], totals.calls, totals.total, totals.min, totals.max });
+				}
+			}
+			for (std::size_t c = 0; c < _profile.counters.size(); ++c)
+			{
+				if (_profile.counters[c] > 0)
+				{
+					stats.counters.push_back({ _registry.counter_names[c], _profile.counters[c] });
+				}
+			}
+			stats.trace_events = _profile.events.size();
+			stats.dropped_events = _profile.dropped;
+			return stats;
+		}
+
+		std::string Escape(const std::string& _text)
+		{
+			std::string escaped;
+			for (const char c : _text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					escaped += '\\';
+					escaped += c;
+				}
+				else if (static_cast<unsigned char>(c) < 0x20)
+				{
+					escaped += ' ';
+				}
+				else
+				{
+					escaped += c;
+				}
+			}
+			return escaped;
+		}
+
+		void WriteStats(std::ostream& _out, const Profiler::ThreadStats& _stats, const char* _indent)
+		{
+			_out << _indent << "\"zones\": [";
+			for (std::size_t z = 0; z < _stats.zones.size(); ++z)
+			{
+				const Profiler::ZoneStats& zone = _stats.zones[z];
+				_out << (z ? ",\n" : "\n") << _indent << "\t{ \"name\": \"" << Escape(zone.name) << "\", \"calls\": " << zone.calls
+					 << ", \"total_ns\": " << zone.total << ", \"mean_ns\": " << zone.total / zone.calls
+					 << ", \"min_ns\": " << zone.min << ", \"max_ns\": " << zone.max << " }";
+			}
+			_out << (_stats.zones.empty() ? "],\n" : "\n" + std::string(_indent) + "],\n");
+			_out << _indent << "\"counters\": [";
+			for (std::size_t c = 0; c < _stats.counters.size(); ++c)
+			{
+				const Profiler::CounterStats& counter = _stats.counters[c];
+				_out << (c ? ",\n" : "\n") << _indent << "\t{ \"name\": \"" << Escape(counter.name) << "\", \"value\": " << counter.value << " }";
+			}
+			_out << (_stats.counters.empty() ? "]\n" : "\n" + std::string(_indent) + "]\n");
+		}
+	}
+
+	void Profiler::SetEnabled(bool _enabled)
+	{
+		enabled_.store(_enabled, std::memory_order_relaxed);
+	}
+
+	void Profiler::SetTraceCapacity(std::size_t _events)
+	{
+		trace_capacity.store(_events, std::memory_order_relaxed);
+	}
+
+	void Profiler::SetThreadName(const std::string& _name)
+	{
+		ThreadProfile& profile = CurrentThread();
+		std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+		profile.name = _name;
+	}
+
+	void Profiler::Reset()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (auto& profile : registry.threads)
+		{
+			profile->zones.clear();
+			profile->counters.clear();
+			profile->events.clear();
+			profile->dropped = 0;
+		}
+	}
+
+	std::vector<Profiler::ThreadStats> Profiler::GetThreads()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		std::vector<ThreadStats> threads;
+		for (const auto& profile : registry.threads)
+		{
+			ThreadStats stats = Collect(*profile, registry);
+			if (!stats.zones.empty() || !stats.counters.empty())
+			{
+				threads.push_back(std::move(stats));
+			}
+		}
+		return threads;
+	}
+
+	Profiler::ThreadStats Profiler::GetTotals()
+	{
+		ThreadProfile merged;
+		merged.id = -1;
+		merged.name = "Total";
+		std::size_t trace_events = 0;
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (const auto& profile : registry.threads)
+		{
+			if (merged.zones.size() < profile->zones.size())
+			{
+				merged.zones.resize(profile->zones.size());
+			}
+			for (std::size_t z = 0; z < profile->zones.size(); ++z)
+			{
+				const Totals& totals = profile->zones[z];
+				merged.zones[z].calls += totals.calls;
+				merged.zones[z].total += totals.total;
+				merged.zones[z].min = std::min(merged.zones[z].min, totals.min);
+				merged.zones[z].max = std::max(merged.zones[z].max, totals.max);
+			}
+			if (merged.counters.size() < profile->counters.size())
+			{
+				merged.counters.resize(profile->counters.size());
+			}
+			for (std::size_t c = 0; c < profile->counters.size(); ++c)
+			{
+				merged.counters[c] += profile->counters[c];
+			}
+			trace_events += profile->events.size();
+			merged.dropped += profile->dropped;
+		}
+		ThreadStats totals = Collect(merged, registry);
+		totals.trace_events = trace_events;
+		return totals;
+	}
+
+	bool Profiler::WriteReport(const std::string& _file_name)
+	{
+		std::ofstream file(_file_name);
+		if (!file)
+		{
+			return false;
+		}
+		const ThreadStats totals = GetTotals();
+		const std::vector<ThreadStats> threads = GetThreads();
+
+		file << "{\n\t\"totals\": {\n";
+		WriteStats(file, totals, "\t\t");
+		file << "\t},\n\t\"threads\": [";
+		for (std::size_t t = 0; t < threads.size(); ++t)
+		{
+			file << (t ? ",\n" : "\n") << "\t\t{\n\t\t\t\"id\": " << threads[t].id << ",\n\t\t\t\"name\": \"" << Escape(threads[t].name)
+				 << "\",\n\t\t\t\"trace_events\": " << threads[t].trace_events
+				 << ",\n\t\t\t\"dropped_events\": " << threads[t].dropped_events << ",\n";
+			WriteStats(file, threads[t], "\t\t\t");
+			file << "\t\t}";
+		}
+		file << (threads.empty() ? "]\n}\n" : "\n\t]\n}\n");
+		return static_cast<bool>(file);
+	}
+
+	bool Profiler::WriteTrace(const std::string& _file_name)
+	{
+		std::ofstream file(_file_name);
+		if (!file)
+		{
+			return false;
+		}
+		file.setf(std::ios::fixed);
+		file.precision(3);
+
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		file << "{\n\"displayTimeUnit\": \"ns\",\n\"traceEvents\": [";
+		bool first = true;
+		for (const auto& profile : registry.threads)
+		{
+			if (profile->events.empty())
+			{
+				continue;
+			}
+			file << (first ? "\n" : ",\n") << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << profile->id
+				 << ", \"args\": { \"name\": \"" << Escape(profile->name) << "\" } }";
+			first = false;
+			// Trace timestamps are in microseconds.
+			for (const Event& event : profile->events)
+			{
+				file << ",\n{ \"name\": \"" << Escape(registry.zone_names[event.zone]) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << profile->id
+					 << ", \"ts\": " << event.start * 1e-3 << ", \"dur\": " << event.duration * 1e-3 << " }";
+			}
+		}
+		file << "\n]\n}\n";
+		return static_cast<bool>(file);
+	}
+
+	int Profiler::RegisterZone(const char* _name)
+	{
+		return Register(GetRegistry().zone_names, _name);
+	}
+
+	int Profiler::RegisterCounter(const char* _name)
+	{
+		return Register(GetRegistry().counter_names, _name);
+	}
+
+	std::int64_t Profiler::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+	}
+
+	void Profiler::Record(int _zone, std::int64_t _start, std::int64_t _end)
+	{
+		ThreadProfile& profile = CurrentThread();
+		if (static_cast<std::size_t>(_zone) >= profile.zones.size())
+		{
+			profile.zones.resize(_zone + 1);
+		}
+		const std::uint64_t duration = static_cast<std::uint64_t>(std::max<std::int64_t>(_end - _start, 0));
+		Totals& totals = profile.zones[_zone];
+		++totals.calls;
+		totals.total += duration;
+		totals.min = std::min(totals.min, duration);
+		totals.max = std::max(totals.max, duration);
+
+		const std::size_t capacity = trace_capacity.load(std::memory_order_relaxed);
+		if (profile.events.size() < capacity)
+		{
+			if (profile.events.capacity() < capacity)
+			{
+				// Reserved once, so recording never reallocates mid run.
+				profile.events.reserve(capacity);
+			}
+			profile.events.push_back({ _zone, _start, static_cast<std::int64_t>(duration) });
+		}
+		else if (capacity > 0)
+		{
+			++profile.dropped;
+		}
+	}
+
+	void Profiler::Count(int _counter, std::uint64_t _amount)
+	{
+		ThreadProfile& profile = CurrentThread();
+		if (static_cast<std::size_t>(_counter) >= profile.counters.size())
+		{
+			profile.counters.resize(_counter + 1);
+		}
+		profile.counters[_counter] += _amount;
+	}
+}
@@ -0,0 +1,155 @@
+#ifndef _AGNOSTIC_PROFILER_H_
+#define _AGNOSTIC_PROFILER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace agn
+{
+	// Profiler
+	// Scoped timers and counters for finding where time goes. Every thread records into its own
+	// tables (calls, total, min and max per zone, a total per counter and a bounded buffer of
+	// trace events), so recording never locks. Reports merge the threads on request.
+	// Zones and counters are named by string literals and registered once per call site by the
+	// AGN_PROFILE_SCOPE and AGN_PROFILE_COUNT macros. While disabled a scope costs one relaxed
+	// load; defining AGN_DISABLE_PROFILING compiles the macros out altogether.
+	class Profiler
+	{
+	public:
+
+		struct ZoneStats
+		{
+			const char* name;
+			std::uint64_t calls;
+			// Nanoseconds, including time spent in zones nested inside this one.
+			std::uint64_t total;
+			std::uint64_t min;
+			std::uint64_t max;
+		};
+
+		struct CounterStats
+		{
+			const char* name;
+			std::uint64_t value;
+		};
+
+		struct ThreadStats
+		{
+			int id;
+			std::string name;
+			std::vector<ZoneStats> zones;
+			std::vector<CounterStats> counters;
+			std::size_t trace_events;
+			std::uint64_t dropped_events;
+		};
+
+		// Events kept per thread for WriteTrace() unless SetTraceCapacity() says otherwise.
+		static const std::size_t kDefaultTraceCapacity = 1 << 16;
+
+		// SetEnabled
+		// Starts or stops recording. Disabled by default.
+		static void SetEnabled(bool _enabled);
+		static inline bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+		// SetTraceCapacity
+		// IN:		Trace events kept per thread, zero to keep none. Later events are counted as dropped.
+		static void SetTraceCapacity(std::size_t _events);
+
+		// SetThreadName
+		// Names the calling thread in reports and traces. Threads are otherwise named by number.
+		static void SetThreadName(const std::string& _name);
+
+		// Reset
+		// Clears everything recorded so far. Call while no other thread is recording.
+		static void Reset();
+
+		// GetThreads
+		// Per thread totals of every zone and counter that recorded anything, in registration order.
+		// Call while no other thread is recording, e.g. after joining workers or waiting on a pool.
+		static std::vector<ThreadStats> GetThreads();
+
+		// GetTotals
+		// As GetThreads(), merged over every thread.
+		static ThreadStats GetTotals();
+
+		// WriteReport
+		// Writes the totals and the per thread breakdown as JSON. Same calling rules as GetThreads().
+		// OUT:		False if the file cannot be written
+		static bool WriteReport(const std::string& _file_name);
+
+		// WriteTrace
+		// Writes the recorded trace events in the Chrome trace event format, for chrome://tracing
+		// or Perfetto. Same calling rules as GetThreads().
+		// OUT:		False if the file cannot be written
+		static bool WriteTrace(const std::string& _file_name);
+
+		// Used by the macros.
+		static int RegisterZone(const char* _name);
+		static int RegisterCounter(const char* _name);
+		// Nanoseconds since the profiler was first used.
+		static std::int64_t Now();
+		static void Record(int _zone, std::int64_t _start, std::int64_t _end);
+		static void Count(int _counter, std::uint64_t _amount);
+
+	private:
+
+		static std::atomic<bool> enabled_;
+	};
+
+	// ProfileScope
+	// Records the time from construction to destruction against a zone, if the profiler was
+	// enabled at construction.
+	class ProfileScope
+	{
+	public:
+
+		explicit ProfileScope(int _zone) :
+			zone_(_zone),
+			start_(Profiler::IsEnabled() ? Profiler::Now() : -1)
+		{}
+
+		~ProfileScope()
+		{
+			if (start_ >= 0)
+			{
+				Profiler::Record(zone_, start_, Profiler::Now());
+			}
+		}
+
+	private:
+
+		ProfileScope(const ProfileScope&);
+		ProfileScope& operator=(const ProfileScope&);
+
+		int zone_;
+		std::int64_t start_;
+	};
+}
+
+#define AGN_PROFILE_CONCAT_INNER(_a, _b) _a##_b
+#define AGN_PROFILE_CONCAT(_a, _b) AGN_PROFILE_CONCAT_INNER(_a, _b)
+
+#ifndef AGN_DISABLE_PROFILING
+// Times the rest of the enclosing block as zone _name (a string literal).
+#define AGN_PROFILE_SCOPE(_name) \
+	static const int AGN_PROFILE_CONCAT(agn_profile_zone_, __LINE__) = agn::Profiler::RegisterZone(_name); \
+	const agn::ProfileScope AGN_PROFILE_CONCAT(agn_profile_scope_, __LINE__)(AGN_PROFILE_CONCAT(agn_profile_zone_, __LINE__))
+// Adds _amount to counter _name (a string literal).
+#define AGN_PROFILE_COUNT(_name, _amount) \
+	do \
+	{ \
+		if (agn::Profiler::IsEnabled()) \
+		{ \
+			static const int agn_profile_counter = agn::Profiler::RegisterCounter(_name); \
+			agn::Profiler::Count(agn_profile_counter, static_cast<std::uint64_t>(_amount)); \
+		} \
+	} while (false)
+#else
+#define AGN_PROFILE_SCOPE(_name) ((void)0)
+#define AGN_PROFILE_COUNT(_name, _amount) ((void)0)
+#endif
+
+#endif // _AGNOSTIC_PROFILER_H_
@@ -0,0 +1,170 @@
+#ifndef _AGNOSTIC_WORK_STEALING_POOL_H_
+#define _AGNOSTIC_WORK_STEALING_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace agn
+{
+	// WorkStealingPool
+	// Fixed set of worker threads, each with its own task deque. A worker runs its own
+	// tasks newest first and, when it runs dry, steals the oldest task from another worker.
+	// Tasks receive the index of the worker running them, so callers can keep per worker
+	// state (e.g. a non thread safe object cloned once per worker) in a plain array.
+	class WorkStealingPool
+	{
+	public:
+
+		typedef std::function<void(unsigned)> Task;
+
+		// Construction
+		// IN:		Number of worker threads, zero for std::thread::hardware_concurrency()
+		explicit WorkStealingPool(unsigned _threads = 0) :
+			queues_(std::max(1u, _threads ? _threads : std::thread::hardware_concurrency())),
+			next_queue_(0),
+			queued_(0),
+			pending_(0),
+			stopping_(false)
+		{
+			for (auto& queue : queues_)
+			{
+				queue.reset(new Queue);
+			}
+			for (unsigned i = 0; i < queues_.size(); ++i)
+			{
+				threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+			}
+		}
+
+		~WorkStealingPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stopping_ = true;
+			}
+			work_available_.notify_all();
+			for (auto& thread : threads_)
+			{
+				thread.join();
+			}
+		}
+
+		WorkStealingPool(const WorkStealingPool&) = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		inline unsigned GetThreadCount() const { return static_cast<unsigned>(queues_.size()); }
+
+		// Submit
+		// Queues a task. Tasks are dealt to workers round robin; stealing evens out the rest.
+		void Submit(Task _task)
+		{
+			Queue& queue = *queues_[next_queue_++ % queues_.size()];
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				{
+					std::lock_guard<std::mutex> queue_lock(queue.mutex);
+					queue.tasks.push_back(std::move(_task));
+				}
+				++queued_;
+				++pending_;
+			}
+			work_available_.notify_one();
+		}
+
+		// Wait
+		// Blocks until every submitted task has finished.
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			all_done_.wait(lock, [this]() { return pending_ == 0; });
+		}
+
+	private:
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		bool PopOwn(unsigned _worker, Task& _task)
+		{
+			Queue& queue = *queues_[_worker];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+			{
+				return false;
+			}
+			_task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+
+		bool Steal(unsigned _worker, Task& _task)
+		{
+			for (std::size_t offset = 1; offset < queues_.size(); ++offset)
+			{
+				Queue& queue = *queues_[(_worker + offset) % queues_.size()];
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if (!queue.tasks.empty())
+				{
+					_task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void WorkerLoop(unsigned _worker)
+		{
+			for (;;)
+			{
+				Task task;
+				if (PopOwn(_worker, task) || Steal(_worker, task))
+				{
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						--queued_;
+					}
+					task(_worker);
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (--pending_ == 0)
+					{
+						all_done_.notify_all();
+					}
+					continue;
+				}
+
+				// Nothing to run anywhere; sleep until something is queued or the pool closes.
+				// queued_ is raised under mutex_ together with the push, so no wakeup is lost.
+				std::unique_lock<std::mutex> lock(mutex_);
+				work_available_.wait(lock, [this]() { return stopping_ || queued_ > 0; });
+				if (stopping_ && queued_ == 0)
+				{
+					return;
+				}
+			}
+		}
+
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::vector<std::thread> threads_;
+		std::atomic<unsigned> next_queue_;
+
+		std::mutex mutex_;
+		std::condition_variable work_available_;
+		std::condition_variable all_done_;
+		std::size_t queued_;
+		std::size_t pending_;
+		bool stopping_;
+	};
+}
+
+#endif // _AGNOSTIC_WORK_STEALING_POOL_H_
@@ -1,4 +1,7 @@
 #include "application.h"
+#include <algorithm>
+#include <chrono>
+#include <agnostic\profiler.h>
 #include <SFML_Extensions\global.h>
 
 namespace sfx
@@ -7,13 +10,40 @@ namespace sfx
 		window_(_window),
 		clock_(),
 		font_(),
-		hud_(clock_, font_)
+		hud_(clock_, font_),
+		running_(false),
+		step_(sf::microseconds(1000000 / 60)),
+		max_catch_up_(5),
+		threaded_(false),
+		interpolation_(0.0f)
 	{
 	}
 
+	void Application::SetStepRate(unsigned _steps_per_second)
+	{
+		// Whole microseconds, so every step is exactly the same length.
+		step_ = sf::microseconds(1000000 / std::max(1u, _steps_per_second));
+	}
+
+	void Application::SetMaxCatchUp(unsigned _steps)
+	{
+		max_catch_up_ = std::max(1u, _steps);
+	}
+
+	void Application::SetThreadedSimulation(bool _threaded)
+	{
+		threaded_ = _threaded;
+	}
+
 	void Application::Run()
 	{
 		running_ = Initialize();
+		agn::Profiler::SetThreadName("Render");
+		step_clock_.restart();
+		if (running_ && threaded_)
+		{
+			simulation_thread_ = std::thread(&Application::SimulationLoop, this);
+		}
 		while (running_)
 		{
 			clock_.beginFrame();
@@ -25,9 +55,30 @@ namespace sfx
 			}
 			if (running_)
 			{
-				running_ = Update();
+				{
+					std::lock_guard<std::mutex> lock(simulation_mutex_);
+					if (!Update())
+					{
+						running_ = false;
+					}
+					if (running_ && !threaded_ && Advance(step_clock_.restart()) < 0)
+					{
+						running_ = false;
+					}
+					if (running_)
+					{
+						Publish();
+					}
+				}
 				if (running_)
 				{
+					{
+						std::lock_guard<std::mutex> lock(snapshot_mutex_);
+						AcquireSnapshot();
+						const float ahead = (published_remainder_ + publish_clock_.getElapsedTime()) / step_;
+						interpolation_ = std::min(ahead, 1.0f);
+					}
+					AGN_PROFILE_SCOPE("render.frame");
 					window_.clear(sf::Color::Black);
 					Render();
 					window_.draw(hud_);
@@ -36,11 +87,70 @@ namespace sfx
 			}
 			clock_.endFrame();
 		}
+		running_ = false;
+		if (simulation_thread_.joinable())
+		{
+			simulation_thread_.join();
+		}
 		window_.close();
 		CleanUp();
 		Global::UnloadGlobalResources();
 	}
 
+	int Application::Advance(sf::Time _elapsed)
+	{
+		accumulator_ += _elapsed;
+		unsigned steps = 0;
+		while (accumulator_ >= step_ && steps < max_catch_up_)
+		{
+			AGN_PROFILE_SCOPE("simulation.fixed_update");
+			if (!FixedUpdate(step_))
+			{
+				return -1;
+			}
+			accumulator_ -= step_;
+			++steps;
+		}
+		// Too far behind to catch up (e.g. a frame blocked on console input): drop the whole
+		// steps owed and keep the fraction, rather than simulating a huge step or spiralling.
+		if (accumulator_ >= step_)
+		{
+			accumulator_ = sf::microseconds(accumulator_.asMicroseconds() % step_.asMicroseconds());
+		}
+		return static_cast<int>(steps);
+	}
+
+	void Application::Publish()
+	{
+		std::lock_guard<std::mutex> lock(snapshot_mutex_);
+		PublishSnapshot();
+		// Real time already owed past the snapshot's last step; Render() adds the time since.
+		published_remainder_ = accumulator_ + step_clock_.getElapsedTime();
+		publish_clock_.restart();
+	}
+
+	void Application::SimulationLoop()
+	{
+		agn::Profiler::SetThreadName("Simulation");
+		while (running_)
+		{
+			{
+				std::lock_guard<std::mutex> lock(simulation_mutex_);
+				const int steps = Advance(step_clock_.restart());
+				if (steps < 0)
+				{
+					running_ = false;
+				}
+				else if (steps > 0)
+				{
+					Publish();
+				}
+			}
+			// Sleep until the next step is due. accumulator_ is only written by this thread.
+			std::this_thread::sleep_for(std::chrono::microseconds((step_ - accumulator_).asMicroseconds()));
+		}
+	}
+
 	void Application::EventLoop()
 	{
 		sf::Event event;
@@ -1,6 +1,9 @@
 #ifndef _SFX_APPLICATION_H_
 #define _SFX_APPLICATION_H_
 
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <SFML\Graphics\RenderWindow.hpp>
 #include "frame_clock.h"
 #include "system_HUD.h"
@@ -16,8 +19,26 @@ namespace sfx
 
 		void Run();
 
+		// Fixed step scheduling
+		// FixedUpdate() is called with a constant step, as many times as real time requires,
+		// independent of the frame rate. Frames that fall further behind than the catch up cap
+		// drop the excess time rather than spiralling. These must be set before Run().
+		// IN:		Fixed updates per second
+		void SetStepRate(unsigned _steps_per_second);
+		// IN:		Most fixed updates run to catch up on one frame
+		void SetMaxCatchUp(unsigned _steps);
+		// IN:		True to run FixedUpdate() on its own thread, handing snapshots to the render thread
+		void SetThreadedSimulation(bool _threaded);
+
+		inline sf::Time GetStep() const { return step_; }
+
 	protected:
 
+		// GetInterpolation
+		// OUT:		How far real time is between the last published fixed step and the next one,
+		//			from 0 to 1. Valid inside Render() for blending previous and current state.
+		inline float GetInterpolation() const { return interpolation_; }
+
 		sfx::FrameClock clock_;
 		sf::RenderWindow& window_;
 		sf::Font font_;
@@ -31,10 +52,41 @@ namespace sfx
 		// Default event handling does nothing.
 		virtual void ProcessEvent(sf::Event& _event) {}
 
+		// Fixed step hooks. Defaults do nothing, so frame based applications are unaffected.
+		// FixedUpdate() and Update() never run at the same time, even with a simulation thread.
+		// PublishSnapshot() runs after simulation state changes and AcquireSnapshot() before
+		// Render(); both are called under the snapshot lock, so copying simulation state into a
+		// snapshot in one and out of it in the other is all the synchronisation Render() needs.
+		virtual bool FixedUpdate(sf::Time _step) { return true; }
+		virtual void PublishSnapshot() {}
+		virtual void AcquireSnapshot() {}
+
 		void EventLoop();
 
+		// Advance
+		// Runs the fixed updates owed for _elapsed real time. Caller holds simulation_mutex_.
+		// OUT:		Number of fixed updates run, or -1 if FixedUpdate() asked to quit
+		int Advance(sf::Time _elapsed);
+		// Publish
+		// Hands a snapshot to the render side. Caller holds simulation_mutex_.
+		void Publish();
+		void SimulationLoop();
+
 		SystemHUD hud_;
-		bool running_;
+		std::atomic<bool> running_;
+
+		sf::Time step_;
+		unsigned max_catch_up_;
+		bool threaded_;
+		sf::Time accumulator_;
+		sf::Clock step_clock_;
+		sf::Clock publish_clock_;
+		sf::Time published_remainder_;
+		float interpolation_;
+
+		std::mutex simulation_mutex_;
+		std::mutex snapshot_mutex_;
+		std::thread simulation_thread_;
 	};
 }
 #endif // _SFX_APPLICATION_H_
\ No newline at end of file
@@ -0,0 +1,416 @@
+// Headless batch simulation of the fuzzy car controller.
+// Runs a grid of initial (displacement, velocity) pairs without a window or console
+// prompts and streams one CSV line per trajectory to stdout.
+//
+// Usage:
+//		headless [--displacement min max count] [--velocity min max count]
+//				 [--steps n] [--timestep dt] [--tolerance t] [--threads n] [--block n]
+//				 [--controller engine|flat] [--surface n] [--bicubic] [--surface-file path] [--surface-check samples]
+//				 [--integrator euler|semi-implicit|rk4|rk45] [--integrator-tolerance t] [--record path]
+//				 [--engine path] [--engine-cache path] [--profile prefix]
+//
+// --controller flat evaluates with the flattened kernel compiled from the fuzzy engine.
+// --engine loads the fuzzy engine from an .fll file instead of building the default one. With
+// --controller flat the compiled tables are cached in --engine-cache (default path.cache) and
+// later runs load them without parsing the file or building an engine.
+// --surface replaces the fuzzy engine with an n x n precompiled control surface.
+// --surface-file loads the table from path if it was sampled from the same controller (engine
+// text and --controller) with the same size, otherwise builds and saves it there.
+// --integrator picks how each timestep is advanced; rk45 subdivides it to --integrator-tolerance.
+// --record writes every step of every trajectory to a trajectory log, one run per trajectory.
+// Recorded trajectories are simulated on the main thread so runs reach the log in order.
+// --profile times the inference stages and integration of the run and writes per thread totals
+// to prefix.json and a Chrome trace (chrome://tracing) to prefix.trace.json.
+//
+// Building:
+// The solution links the prebuilt Windows fuzzylite in external/lib. Nothing here uses a window
+// or platform API, so elsewhere build fuzzylite 5 from source with FL_CPP11 to match the headers
+// in external/include and compile against it, e.g. from the repository root on Linux:
+//		g++ -std=c++14 -O2 -pthread -DFL_CPP11 -I external/include/Fuzzylite -I external/include
+//			headless/main.cpp source/Controller/*.cpp source/Simulation/*.cpp source/Recording/*.cpp
+//			external/include/Agnostic/profiler.cpp -lfuzzylite -o headless
+// The exporter, tuner, benchmark and scenarios tools build the same way from their main.cpp
+// and the sources their projects list.
+
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <Agnostic/profiler.h>
+#include "../source/Controller/control_surface.h"
+#include "../source/Controller/controller_loader.h"
+#include "../source/Controller/engine_controller.h"
+#include "../source/Controller/flat_controller.h"
+#include "../source/Recording/trajectory_recorder.h"
+#include "../source/Simulation/simulator.h"
+
+namespace
+{
+	struct Options
+	{
+		double displacement_min = -1.0, displacement_max = 1.0;
+		int displacement_count = 21;
+		double velocity_min = -1.0, velocity_max = 1.0;
+		int velocity_count = 21;
+		car::SimulationSettings settings;
+		// Trajectories simulated before results are flushed to stdout.
+		std::size_t block = 16384;
+		std::string controller = "engine";
+		// Control surface points per axis, zero to run the fuzzy engine directly.
+		int surface = 0;
+		bool bicubic = false;
+		std::string surface_file;
+		int surface_check = 257;
+		std::string record_file;
+		std::string profile;
+		std::string engine_file;
+		std::string engine_cache;
+	};
+
+	void PrintUsage()
+	{
+		std::cerr << "Usage: headless [--displacement min max count] [--velocity min max count]\n"
+					 "                [--steps n] [--timestep dt] [--tolerance t] [--threads n] [--block n]\n"
+					 "                [--controller engine|flat] [--surface n] [--bicubic] [--surface-file path] [--surface-check samples]\n"
+					 "                [--integrator euler|semi-implicit|rk4|rk45] [--integrator-tolerance t] [--record path]\n"
+					 "                [--engine path] [--engine-cache path] [--profile prefix]\n";
+	}
+
+	bool ParseOptions(int _argc, char** _argv, Options& _options)
+	{
+		for (int i = 1; i < _argc; ++i)
+		{
+			const std::string arg(_argv[i]);
+			const int remaining = _argc - i - 1;
+			if (arg == "--displacement" && remaining >= 3)
+			{
+				_options.displacement_min = std::atof(_argv[++i]);
+				_options.displacement_max = std::atof(_argv[++i]);
+				_options.displacement_count = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--velocity" && remaining >= 3)
+			{
+				_options.velocity_min = std::atof(_argv[++i]);
+				_options.velocity_max = std::atof(_argv[++i]);
+				_options.velocity_count = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--steps" && remaining >= 1)
+			{
+				_options.settings.steps = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--timestep" && remaining >= 1)
+			{
+				_options.settings.timestep = std::atof(_argv[++i]);
+			}
+			else if (arg == "--tolerance" && remaining >= 1)
+			{
+				_options.settings.settle_tolerance = std::atof(_argv[++i]);
+			}
+			else if (arg == "--threads" && remaining >= 1)
+			{
+				_options.settings.threads = static_cast<unsigned>(std::atoi(_argv[++i]));
+			}
+			else if (arg == "--block" && remaining >= 1)
+			{
+				_options.block = static_cast<std::size_t>(std::atoi(_argv[++i]));
+			}
+			else if (arg == "--controller" && remaining >= 1)
+			{
+				_options.controller = _argv[++i];
+			}
+			else if (arg == "--surface" && remaining >= 1)
+			{
+				_options.surface = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--bicubic")
+			{
+				_options.bicubic = true;
+			}
+			else if (arg == "--surface-file" && remaining >= 1)
+			{
+				_options.surface_file = _argv[++i];
+			}
+			else if (arg == "--surface-check" && remaining >= 1)
+			{
+				_options.surface_check = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--integrator" && remaining >= 1)
+			{
+				if (!car::ParseIntegration(_argv[++i], _options.settings.integration))
+				{
+					std::cerr << "Unknown integrator: " << _argv[i] << "\n";
+					return false;
+				}
+			}
+			else if (arg == "--integrator-tolerance" && remaining >= 1)
+			{
+				_options.settings.integration_tolerance = std::atof(_argv[++i]);
+			}
+			else if (arg == "--record" && remaining >= 1)
+			{
+				_options.record_file = _argv[++i];
+			}
+			else if (arg == "--profile" && remaining >= 1)
+			{
+				_options.profile = _argv[++i];
+			}
+			else if (arg == "--engine" && remaining >= 1)
+			{
+				_options.engine_file = _argv[++i];
+			}
+			else if (arg == "--engine-cache" && remaining >= 1)
+			{
+				_options.engine_cache = _argv[++i];
+			}
+			else
+			{
+				std::cerr << "Unrecognised or incomplete argument: " << arg << "\n";
+				return false;
+			}
+		}
+
+		if (_options.displacement_count < 1 || _options.velocity_count < 1 ||
+			_options.settings.steps < 0 || _options.surface == 1 || _options.surface < 0 || _options.settings.timestep <= 0.0 || _options.block == 0 ||
+			_options.settings.integration_tolerance <= 0.0)
+		{
+			std::cerr << "Counts, block size, timestep and integrator tolerance must be positive.\n";
+			return false;
+		}
+		if (_options.controller != "engine" && _options.controller != "flat")
+		{
+			std::cerr << "Unknown controller: " << _options.controller << "\n";
+			return false;
+		}
+		if (_options.engine_cache.empty() && !_options.engine_file.empty())
+		{
+			_options.engine_cache = car::DefaultCacheFile(_options.engine_file);
+		}
+		return true;
+	}
+
+	// Loads the flat kernel for an .fll file, from its compiled cache when that is current.
+	bool LoadFlatController(const Options& _options, std::unique_ptr<car::SteeringController>& _controller)
+	{
+		std::unique_ptr<car::FlatController> flat(new car::FlatController);
+		std::string status;
+		bool from_cache = false;
+		const auto start = std::chrono::steady_clock::now();
+		if (!car::LoadCompiled(_options.engine_file, _options.engine_cache, *flat, &status, &from_cache))
+		{
+			std::cerr << "Failed to load flat controller from " << _options.engine_file << ":\n" << status;
+			return false;
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cerr << "Flat controller (" << flat->GetRuleCount() << " rules) "
+				  << (from_cache ? "loaded from " + _options.engine_cache : "compiled from " + _options.engine_file)
+				  << " in " << elapsed.count() << " s" << std::endl << status;
+
+		_controller.reset(flat.release());
+		return true;
+	}
+
+	// Replaces _controller with the flat kernel compiled from its engine.
+	bool UseFlatController(std::unique_ptr<car::SteeringController>& _controller)
+	{
+		car::EngineController& engine = static_cast<car::EngineController&>(*_controller);
+		std::unique_ptr<car::FlatController> flat(new car::FlatController);
+		std::string status;
+		if (!flat->Compile(*engine.GetEngine(), &status))
+		{
+			std::cerr << "Failed to compile flat controller:\n" << status;
+			return false;
+		}
+
+		const car::ControllerError error = car::CompareControllers(*flat, engine, 101);
+		std::cerr << "Flat controller (" << flat->GetRuleCount() << " rules) vs engine over 101x101 samples: max "
+				  << error.maximum << ", mean " << error.mean << std::endl;
+		if (error.maximum > car::FlatController::kTolerance)
+		{
+			std::cerr << "Flat controller exceeds its documented tolerance of " << car::FlatController::kTolerance << std::endl;
+		}
+
+		_controller.reset(flat.release());
+		return true;
+	}
+
+	// Replaces _controller with a control surface sampled from it, or loaded from disk if the
+	// saved table was sampled from the same controller, as identified by _key.
+	bool UseControlSurface(const Options& _options, std::uint64_t _key, std::unique_ptr<car::SteeringController>& _controller)
+	{
+		std::unique_ptr<car::ControlSurface> surface(new car::ControlSurface);
+		const auto start = std::chrono::steady_clock::now();
+
+		bool loaded = !_options.surface_file.empty() && surface->Load(_options.surface_file, _key) &&
+			surface->GetDisplacementCount() == _options.surface && surface->GetVelocityCount() == _options.surface;
+		if (!loaded)
+		{
+			if (!surface->Build(*_controller, _options.surface, _options.surface))
+			{
+				std::cerr << "Failed to build a " << _options.surface << " point control surface." << std::endl;
+				return false;
+			}
+			if (!_options.surface_file.empty() && !surface->Save(_options.surface_file, _key))
+			{
+				std::cerr << "Failed to save control surface to " << _options.surface_file << std::endl;
+			}
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		surface->SetInterpolation(_options.bicubic ? car::ControlSurface::INTERPOLATION::BICUBIC
+												   : car::ControlSurface::INTERPOLATION::BILINEAR);
+		std::cerr << "Control surface " << _options.surface << "x" << _options.surface
+				  << (loaded ? " loaded in " : " sampled in ") << elapsed.count() << " s" << std::endl;
+
+		if (_options.surface_check >= 2)
+		{
+			const car::ControllerError error = surface->MeasureError(*_controller, _options.surface_check);
+			std::cerr << "Surface error over " << _options.surface_check << "x" << _options.surface_check
+					  << " samples: max " << error.maximum << ", mean " << error.mean << std::endl;
+		}
+
+		_controller.reset(surface.release());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	// Keys saved control surfaces to the engine's FLL text and how it is evaluated.
+	std::uint64_t controller_key = car::ControllerKey(options.engine_file, nullptr, options.controller);
+	std::unique_ptr<car::SteeringController> controller;
+	if (options.engine_file.empty())
+	{
+		try
+		{
+			controller.reset(new car::EngineController(car::BuildCarEngine()));
+		}
+		catch (const fl::Exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		controller_key = car::ControllerKey(options.engine_file, static_cast<car::EngineController&>(*controller).GetEngine(), options.controller);
+		if (options.controller == "flat" && !UseFlatController(controller))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	else if (options.controller == "flat")
+	{
+		if (!LoadFlatController(options, controller))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		std::string status;
+		fl::Engine* engine = car::LoadEngine(options.engine_file, &status);
+		if (!engine)
+		{
+			std::cerr << "Failed to load " << options.engine_file << ":\n" << status;
+			return EXIT_FAILURE;
+		}
+		controller.reset(new car::EngineController(engine));
+	}
+
+	if (options.surface > 0 && !UseControlSurface(options, controller_key, controller))
+	{
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<car::CarState> grid = car::Simulator::Grid(
+		options.displacement_min, options.displacement_max, options.displacement_count,
+		options.velocity_min, options.velocity_max, options.velocity_count);
+	const car::Simulator simulator(*controller, options.settings);
+
+	car::TrajectoryRecorder recorder;
+	if (!options.record_file.empty() && !recorder.Open(options.record_file))
+	{
+		std::cerr << "Failed to create trajectory log " << options.record_file << std::endl;
+		return EXIT_FAILURE;
+	}
+	const car::StepObserver record = [&recorder](double _time, const car::CarState& _state)
+	{
+		const car::TrajectoryRecord step = { _time, _state };
+		recorder.Record(step);
+	};
+
+	std::ios::sync_with_stdio(false);
+	std::cout.precision(6);
+	std::cout << "initial_displacement,initial_velocity,displacement,velocity,steering,settled,settling_time\n";
+
+	if (!options.profile.empty())
+	{
+		agn::Profiler::SetThreadName("Main");
+		agn::Profiler::SetEnabled(true);
+	}
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t begin = 0; begin < grid.size(); begin += options.block)
+	{
+		const std::size_t end = std::min(grid.size(), begin + options.block);
+		const std::vector<car::CarState> block(grid.begin() + begin, grid.begin() + end);
+		std::vector<car::TrajectoryResult> results;
+		if (recorder.IsOpen())
+		{
+			for (const car::CarState& initial : block)
+			{
+				recorder.BeginRun();
+				results.push_back(simulator.Simulate(*controller, initial, record));
+			}
+		}
+		else
+		{
+			results = simulator.Run(block);
+		}
+		for (const car::TrajectoryResult& result : results)
+		{
+			std::cout << result.initial.displacement << ',' << result.initial.velocity << ','
+					  << result.final.displacement << ',' << result.final.velocity << ',' << result.final.steering << ','
+					  << (result.settled ? 1 : 0) << ',' << (result.settled ? result.settling_time : -1.0) << '\n';
+		}
+		std::cout.flush();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (!options.profile.empty())
+	{
+		agn::Profiler::SetEnabled(false);
+		if (!agn::Profiler::WriteReport(options.profile + ".json") || !agn::Profiler::WriteTrace(options.profile + ".trace.json"))
+		{
+			std::cerr << "Failed to write profile " << options.profile << ".json" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (recorder.IsOpen())
+	{
+		const std::uint64_t records = recorder.GetRecordCount();
+		const std::uint64_t stalls = recorder.GetStalls();
+		if (!recorder.Close())
+		{
+			std::cerr << "Failed to write trajectory log " << options.record_file << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cerr << records << " records written to " << options.record_file
+				  << " (" << stalls << " chunks waited on the writer)" << std::endl;
+	}
+
+	// Timesteps include the initial steering of each trajectory. Integrators other than
+	// semi-implicit Euler may evaluate the controller several times per timestep.
+	const double evaluations = static_cast<double>(grid.size()) * (options.settings.steps + 1);
+	std::cerr << grid.size() << " trajectories, " << evaluations << " controller steps in "
+			  << elapsed.count() << " s (" << evaluations / elapsed.count() << " steps/s)" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,705 @@
+// Control loop benchmark suite.
+// Runs fixed scenarios through the controller path and reports steps per second and step latency
+// percentiles, so a change that slows the controller shows up as a number rather than a feeling.
+// Uses no window or platform API, so it runs headless on any system fuzzylite builds on.
+//
+// Scenarios:
+//		single		One car stepped by Simulator::Step() with the flat kernel
+//		engine		One car stepped by Simulator::Step() with fl::Engine::process(), as in the app's real time mode
+//		fleet		10000 cars stepped together by Fleet::Step() with the batch kernel on every core
+//		export		257 x 257 control surface with rule maps built by SurfaceMap on every core
+//
+// Usage:
+//		scenarios [--scenario single|engine|fleet|export] [--threads n] [--engine path] [--json path]
+//				  [--baseline path] [--tolerance t] [--profile prefix]
+//		scenarios --verify [--engine path]
+//
+// --verify		Check every fast path against fl::Engine instead of benchmarking: the flat kernel,
+//				each batch kernel the processor supports and both control surface interpolations
+//				at their grid nodes and beyond their range must steer within FlatController::kTolerance
+//				of the engine, and a trajectory log must read back exactly as it was recorded.
+//				Exits with failure on any mismatch. The project runs it after every build, so a
+//				regression fails the build.
+// --engine		Benchmark the controller in an .fll file, loaded through its compiled cache for the
+//				flat and batch kernels and imported as an fl::Engine for the engine scenario
+// --json		Also write the results as JSON, one scenario per line
+// --baseline	Compare steps/s with a file written by --json and fail if any scenario is slower
+//				than its baseline by more than --tolerance (a fraction, default 0.1)
+// --profile	Also time every inference stage and write prefix.json and prefix.trace.json. Timing
+//				the stages slows them down, so compare profiled runs only with each other.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Agnostic/profiler.h>
+#include "../source/Controller/batch_controller.h"
+#include "../source/Controller/control_surface.h"
+#include "../source/Controller/controller_loader.h"
+#include "../source/Controller/engine_controller.h"
+#include "../source/Controller/flat_controller.h"
+#include "../source/Export/surface_map.h"
+#include "../source/Recording/trajectory_reader.h"
+#include "../source/Recording/trajectory_recorder.h"
+#include "../source/Simulation/fleet.h"
+#include "../source/Simulation/simulator.h"
+
+namespace
+{
+	struct Options
+	{
+		std::string scenario;
+		unsigned threads = 0;
+		std::string engine_file;
+		std::string json_file;
+		std::string baseline_file;
+		double tolerance = 0.1;
+		std::string profile;
+		bool verify = false;
+	};
+
+	struct Result
+	{
+		std::string name;
+		// Controller evaluations and state updates, i.e. car steps or surface points.
+		std::uint64_t steps;
+		double seconds;
+		// What one latency sample times.
+		std::string sample;
+		// Seconds per sample, sorted.
+		std::vector<double> latencies;
+	};
+
+	const double kTimestep = 0.01;
+	// single and engine: a 5 x 5 grid of starts, each run for this many steps. fl::Engine is
+	// far slower than the flat kernel, so it runs fewer.
+	const int kSingleGrid = 5;
+	const int kSingleSteps = 4000;
+	const int kEngineSteps = 1000;
+	// fleet: a 100 x 100 grid of cars.
+	const int kFleetGrid = 100;
+	const int kFleetSteps = 500;
+	const int kFleetWarmUpSteps = 10;
+	// export: the exporter's default grid.
+	const int kExportSize = 257;
+	const int kExportRepeats = 5;
+	// verify: samples per axis compared with the engine, the control surface resolution and the
+	// trajectory log round trip, whose short chunks make every run span several of them.
+	const int kVerifySamples = 101;
+	const int kVerifySurfaceSize = 33;
+	const std::uint32_t kVerifyChunkRecords = 256;
+	const int kVerifyRunSteps[] = { 1000, 2500, 37 };
+	const char* const kVerifyLogFile = "scenarios_verify.trajectory";
+
+	void PrintUsage()
+	{
+		std::cerr << "Usage: scenarios [--scenario single|engine|fleet|export] [--threads n] [--engine path] [--json path]\n"
+					 "                 [--baseline path] [--tolerance t] [--profile prefix]\n"
+					 "       scenarios --verify [--engine path]\n";
+	}
+
+	bool ParseOptions(int _argc, char** _argv, Options& _options)
+	{
+		for (int i = 1; i < _argc; ++i)
+		{
+			const std::string arg(_argv[i]);
+			if (arg == "--scenario" && i + 1 < _argc)
+			{
+				_options.scenario = _argv[++i];
+			}
+			else if (arg == "--threads" && i + 1 < _argc)
+			{
+				_options.threads = static_cast<unsigned>(std::atoi(_argv[++i]));
+			}
+			else if (arg == "--engine" && i + 1 < _argc)
+			{
+				_options.engine_file = _argv[++i];
+			}
+			else if (arg == "--json" && i + 1 < _argc)
+			{
+				_options.json_file = _argv[++i];
+			}
+			else if (arg == "--baseline" && i + 1 < _argc)
+			{
+				_options.baseline_file = _argv[++i];
+			}
+			else if (arg == "--tolerance" && i + 1 < _argc)
+			{
+				_options.tolerance = std::atof(_argv[++i]);
+			}
+			else if (arg == "--profile" && i + 1 < _argc)
+			{
+				_options.profile = _argv[++i];
+			}
+			else if (arg == "--verify")
+			{
+				_options.verify = true;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return (_options.scenario.empty() || _options.scenario == "single" || _options.scenario == "engine" ||
+				_options.scenario == "fleet" || _options.scenario == "export") && _options.tolerance >= 0.0;
+	}
+
+	bool LoadController(const Options& _options, car::FlatController& _compiled)
+	{
+		std::string status;
+		if (!_options.engine_file.empty())
+		{
+			if (!car::LoadCompiled(_options.engine_file, car::DefaultCacheFile(_options.engine_file), _compiled, &status))
+			{
+				std::cerr << "Failed to load " << _options.engine_file << ":\n" << status;
+				return false;
+			}
+			return true;
+		}
+
+		try
+		{
+			std::unique_ptr<fl::Engine> engine(car::BuildCarEngine());
+			if (!_compiled.Compile(*engine, &status))
+			{
+				std::cerr << "Failed to compile flat controller:\n" << status;
+				return false;
+			}
+		}
+		catch (const fl::Exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// LoadEngineController
+	// The fuzzy engine itself, as the app steers the single car with it.
+	bool LoadEngineController(const Options& _options, std::unique_ptr<car::EngineController>& _controller)
+	{
+		if (!_options.engine_file.empty())
+		{
+			std::string status;
+			fl::Engine* engine = car::LoadEngine(_options.engine_file, &status);
+			if (!engine)
+			{
+				std::cerr << "Failed to load " << _options.engine_file << ":\n" << status;
+				return false;
+			}
+			_controller.reset(new car::EngineController(engine));
+			return true;
+		}
+
+		try
+		{
+			_controller.reset(new car::EngineController(car::BuildCarEngine()));
+		}
+		catch (const fl::Exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	inline double Elapsed(std::chrono::steady_clock::time_point _start)
+	{
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+		return elapsed.count();
+	}
+
+	// Nearest rank percentile of sorted samples.
+	double Percentile(const std::vector<double>& _sorted, double _fraction)
+	{
+		if (_sorted.empty())
+		{
+			return 0.0;
+		}
+		const std::size_t rank = static_cast<std::size_t>(std::ceil(_fraction * _sorted.size()));
+		return _sorted[std::min(std::max<std::size_t>(rank, 1), _sorted.size()) - 1];
+	}
+
+	// RunSingle
+	// Steps one car at a time with _controller for _steps steps from each start. Throughput is
+	// measured over untimed steps; a second pass times every step on its own, so its latencies
+	// include one clock read each.
+	Result RunSingle(const std::string& _name, car::SteeringController& _controller, int _steps)
+	{
+		const std::vector<car::CarState> starts = car::Simulator::Grid(-1.0, 1.0, kSingleGrid, -1.0, 1.0, kSingleGrid);
+		auto run = [&_controller, _steps](const car::CarState& _start, std::vector<double>* _latencies)
+		{
+			car::CarState state = car::Simulator::Initialize(_controller, _start.displacement, _start.velocity);
+			for (int step = 0; step < _steps; ++step)
+			{
+				if (_latencies)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					state = car::Simulator::Step(_controller, state, kTimestep);
+					_latencies->push_back(Elapsed(start));
+				}
+				else
+				{
+					state = car::Simulator::Step(_controller, state, kTimestep);
+				}
+			}
+			return state;
+		};
+
+		Result result;
+		result.name = _name;
+		result.sample = "car step";
+		result.steps = static_cast<std::uint64_t>(starts.size()) * _steps;
+		run(starts.front(), nullptr);
+
+		const auto start = std::chrono::steady_clock::now();
+		for (const car::CarState& initial : starts)
+		{
+			run(initial, nullptr);
+		}
+		result.seconds = Elapsed(start);
+
+		result.latencies.reserve(static_cast<std::size_t>(result.steps));
+		for (const car::CarState& initial : starts)
+		{
+			run(initial, &result.latencies);
+		}
+		return result;
+	}
+
+	Result RunFleet(const car::FlatController& _compiled, unsigned _threads)
+	{
+		car::Fleet fleet(_compiled, _threads);
+		fleet.Reset(car::Simulator::Grid(-1.0, 1.0, kFleetGrid, -1.0, 1.0, kFleetGrid));
+		for (int step = 0; step < kFleetWarmUpSteps; ++step)
+		{
+			fleet.Step(kTimestep);
+		}
+		fleet.Restart();
+
+		Result result;
+		result.name = "fleet";
+		result.sample = "fleet step";
+		result.steps = static_cast<std::uint64_t>(fleet.GetCount()) * kFleetSteps;
+		result.latencies.reserve(kFleetSteps);
+		const auto start = std::chrono::steady_clock::now();
+		for (int step = 0; step < kFleetSteps; ++step)
+		{
+			const auto step_start = std::chrono::steady_clock::now();
+			fleet.Step(kTimestep);
+			result.latencies.push_back(Elapsed(step_start));
+		}
+		result.seconds = Elapsed(start);
+		return result;
+	}
+
+	bool RunExport(const car::FlatController& _compiled, unsigned _threads, Result& _result)
+	{
+		car::SurfaceMapSettings settings;
+		settings.displacement_count = kExportSize;
+		settings.velocity_count = kExportSize;
+		settings.threads = _threads;
+
+		_result.name = "export";
+		_result.sample = "surface";
+		_result.steps = static_cast<std::uint64_t>(kExportSize) * kExportSize * kExportRepeats;
+		_result.latencies.reserve(kExportRepeats);
+		const auto start = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < kExportRepeats; ++repeat)
+		{
+			car::SurfaceMap map;
+			std::string status;
+			const auto build_start = std::chrono::steady_clock::now();
+			if (!map.Build(_compiled, settings, &status))
+			{
+				std::cerr << "Failed to build control surface:\n" << status;
+				return false;
+			}
+			_result.latencies.push_back(Elapsed(build_start));
+		}
+		_result.seconds = Elapsed(start);
+		return true;
+	}
+
+	void PrintResults(const std::vector<Result>& _results)
+	{
+		std::cout << std::left << std::setw(8) << "scenario" << std::right << std::setw(10) << "steps"
+				  << std::setw(13) << "steps/s" << "  " << std::left << std::setw(11) << "latency of" << std::right
+				  << std::setw(11) << "p50 us" << std::setw(11) << "p90 us" << std::setw(11) << "p99 us" << std::setw(11) << "max us" << '\n';
+		for (const Result& result : _results)
+		{
+			std::cout << std::left << std::setw(8) << result.name << std::right << std::setw(10) << result.steps
+					  << std::setw(13) << std::fixed << std::setprecision(0) << result.steps / result.seconds << "  "
+					  << std::left << std::setw(11) << result.sample << std::right << std::setprecision(3)
+					  << std::setw(11) << Percentile(result.latencies, 0.5) * 1e6
+					  << std::setw(11) << Percentile(result.latencies, 0.9) * 1e6
+					  << std::setw(11) << Percentile(result.latencies, 0.99) * 1e6
+					  << std::setw(11) << (result.latencies.empty() ? 0.0 : result.latencies.back() * 1e6) << '\n';
+			std::cout.unsetf(std::ios::fixed);
+		}
+	}
+
+	bool WriteJson(const std::string& _file_name, const std::vector<Result>& _results)
+	{
+		std::ofstream file(_file_name);
+		if (!file)
+		{
+			return false;
+		}
+		file.precision(10);
+		file << "{\n\t\"scenarios\": [\n";
+		for (std::size_t i = 0; i < _results.size(); ++i)
+		{
+			const Result& result = _results[i];
+			file << "\t\t{ \"name\": \"" << result.name << "\", \"steps\": " << result.steps << ", \"seconds\": " << result.seconds
+				 << ", \"steps_per_second\": " << result.steps / result.seconds << ", \"latency_sample\": \"" << result.sample
+				 << "\", \"samples\": " << result.latencies.size()
+				 << ", \"p50_us\": " << Percentile(result.latencies, 0.5) * 1e6
+				 << ", \"p90_us\": " << Percentile(result.latencies, 0.9) * 1e6
+				 << ", \"p99_us\": " << Percentile(result.latencies, 0.99) * 1e6
+				 << ", \"max_us\": " << (result.latencies.empty() ? 0.0 : result.latencies.back() * 1e6) << " }"
+				 << (i + 1 < _results.size() ? ",\n" : "\n");
+		}
+		file << "\t]\n}\n";
+		return static_cast<bool>(file);
+	}
+
+	// ReadBaseline
+	// Reads the steps/s of every scenario from a file written by WriteJson().
+	bool ReadBaseline(const std::string& _file_name, std::map<std::string, double>& _steps_per_second)
+	{
+		std::ifstream file(_file_name);
+		if (!file)
+		{
+			return false;
+		}
+		const std::string name_key = "\"name\": \"";
+		const std::string rate_key = "\"steps_per_second\": ";
+		std::string line;
+		while (std::getline(file, line))
+		{
+			const std::size_t name = line.find(name_key);
+			const std::size_t rate = line.find(rate_key);
+			if (name == std::string::npos || rate == std::string::npos)
+			{
+				continue;
+			}
+			const std::size_t name_begin = name + name_key.size();
+			const std::size_t name_end = line.find('"', name_begin);
+			if (name_end != std::string::npos)
+			{
+				_steps_per_second[line.substr(name_begin, name_end - name_begin)] = std::atof(line.c_str() + rate + rate_key.size());
+			}
+		}
+		return true;
+	}
+
+	// CompareBaseline
+	// OUT:		False if any scenario is slower than its baseline by more than _tolerance
+	bool CompareBaseline(const std::vector<Result>& _results, const std::map<std::string, double>& _baseline, double _tolerance)
+	{
+		bool passed = true;
+		for (const Result& result : _results)
+		{
+			const auto baseline = _baseline.find(result.name);
+			if (baseline == _baseline.end() || baseline->second <= 0.0)
+			{
+				std::cout << result.name << ": no baseline\n";
+				continue;
+			}
+			const double ratio = result.steps / result.seconds / baseline->second;
+			const bool regressed = ratio < 1.0 - _tolerance;
+			std::cout << result.name << ": " << std::setprecision(3) << ratio << "x baseline" << (regressed ? "  REGRESSION" : "") << '\n';
+			passed = passed && !regressed;
+		}
+		return passed;
+	}
+	// Check
+	// Prints one verification result.
+	// OUT:		_passed
+	bool Check(const std::string& _name, bool _passed, double _error)
+	{
+		std::cout << (_passed ? "PASS  " : "FAIL  ") << std::left << std::setw(32) << _name << std::right
+				  << " max error " << std::setprecision(3) << _error << '\n';
+		return _passed;
+	}
+
+	// VerifyBatch
+	// Evaluates a grid with every supported batch kernel. Each must match the engine within
+	// the flat kernel's tolerance and the scalar kernel bit for bit.
+	bool VerifyBatch(const car::FlatController& _compiled, car::SteeringController& _engine)
+	{
+		std::vector<double> displacement;
+		std::vector<double> velocity;
+		std::vector<double> reference;
+		for (int d = 0; d < kVerifySamples; ++d)
+		{
+			for (int v = 0; v < kVerifySamples; ++v)
+			{
+				displacement.push_back(-1.0 + 2.0 * d / (kVerifySamples - 1));
+				velocity.push_back(-1.0 + 2.0 * v / (kVerifySamples - 1));
+				reference.push_back(_engine.Steering(displacement.back(), velocity.back()));
+			}
+		}
+
+		bool passed = true;
+		car::BatchController batch(_compiled);
+		std::vector<double> scalar(reference.size());
+		std::vector<double> steering(reference.size());
+		const int widest = static_cast<int>(car::BatchController::DetectISA());
+		for (int isa = 0; isa <= widest; ++isa)
+		{
+			batch.SetISA(static_cast<car::BatchController::ISA>(isa));
+			batch.Steering(displacement.data(), velocity.data(), isa ? steering.data() : scalar.data(), reference.size());
+			const std::vector<double>& output = isa ? steering : scalar;
+
+			double error = 0.0;
+			for (std::size_t i = 0; i < reference.size(); ++i)
+			{
+				error = std::max(error, std::abs(output[i] - reference[i]));
+			}
+			const std::string name = std::string("batch ") + car::BatchController::ISAName(batch.GetISA());
+			passed = Check(name, error <= car::FlatController::kTolerance, error) && passed;
+			if (isa)
+			{
+				double difference = 0.0;
+				for (std::size_t i = 0; i < scalar.size(); ++i)
+				{
+					difference = std::max(difference, std::abs(steering[i] - scalar[i]));
+				}
+				passed = Check(name + " vs " + car::BatchController::ISAName(car::BatchController::ISA::SCALAR), std::equal(steering.begin(), steering.end(), scalar.begin()), difference) && passed;
+			}
+		}
+		return passed;
+	}
+
+	// VerifySurface
+	// The interpolated surface passes through the engine at its grid nodes, and clamping inputs
+	// beyond its range is exact because the car controller's outer terms saturate. The error
+	// between nodes depends on the resolution, so it is only reported.
+	bool VerifySurface(car::SteeringController& _engine)
+	{
+		car::ControlSurface surface;
+		if (!surface.Build(_engine, kVerifySurfaceSize, kVerifySurfaceSize))
+		{
+			std::cerr << "Failed to build control surface" << std::endl;
+			return false;
+		}
+
+		bool passed = true;
+		const double outside[] = { -3.0, -1.5, 1.5, 3.0 };
+		const car::ControlSurface::INTERPOLATION interpolations[] = { car::ControlSurface::INTERPOLATION::BILINEAR,
+																	   car::ControlSurface::INTERPOLATION::BICUBIC };
+		for (const car::ControlSurface::INTERPOLATION interpolation : interpolations)
+		{
+			surface.SetInterpolation(interpolation);
+			const std::string name = interpolation == car::ControlSurface::INTERPOLATION::BILINEAR ? "surface bilinear" : "surface bicubic";
+
+			const car::ControllerError nodes = car::CompareControllers(surface, _engine, kVerifySurfaceSize);
+			passed = Check(name + " nodes", nodes.maximum <= car::FlatController::kTolerance, nodes.maximum) && passed;
+
+			// Every node on the edges, pushed out across the range along the other axis.
+			double clamped = 0.0;
+			for (int node = 0; node < kVerifySurfaceSize; ++node)
+			{
+				const double inside = -1.0 + 2.0 * node / (kVerifySurfaceSize - 1);
+				for (const double beyond : outside)
+				{
+					clamped = std::max(clamped, std::abs(surface.Steering(beyond, inside) - _engine.Steering(beyond, inside)));
+					clamped = std::max(clamped, std::abs(surface.Steering(inside, beyond) - _engine.Steering(inside, beyond)));
+				}
+			}
+			passed = Check(name + " outside range", clamped <= car::FlatController::kTolerance, clamped) && passed;
+
+			const car::ControllerError interior = surface.MeasureError(_engine, kVerifySamples);
+			std::cout << "      " << std::left << std::setw(32) << (name + " between nodes") << std::right
+					  << " max error " << std::setprecision(3) << interior.maximum << "  (" << kVerifySurfaceSize << " x "
+					  << kVerifySurfaceSize << ", not checked)\n";
+		}
+		return passed;
+	}
+
+	inline bool SameRecord(const car::TrajectoryRecord& _a, const car::TrajectoryRecord& _b)
+	{
+		return _a.time == _b.time && _a.state.displacement == _b.state.displacement &&
+			   _a.state.velocity == _b.state.velocity && _a.state.steering == _b.state.steering;
+	}
+
+	// VerifyRecording
+	// Records simulated runs spanning several chunks, then checks the reader returns the same
+	// runs and records, by whole run, by index and by time.
+	bool VerifyRecording(const car::FlatController& _compiled)
+	{
+		std::unique_ptr<car::FlatController> controller(_compiled.Clone());
+		std::vector<std::vector<car::TrajectoryRecord>> runs;
+		car::TrajectoryRecorder recorder;
+		if (!recorder.Open(kVerifyLogFile, kVerifyChunkRecords))
+		{
+			std::cerr << "Failed to create " << kVerifyLogFile << std::endl;
+			return false;
+		}
+		for (const int steps : kVerifyRunSteps)
+		{
+			recorder.BeginRun();
+			runs.emplace_back();
+			car::TrajectoryRecord record = { 0.0, car::Simulator::Initialize(*controller, 1.0 - 0.5 * runs.size(), 0.25 * runs.size()) };
+			for (int step = 0; step < steps; ++step)
+			{
+				recorder.Record(record);
+				runs.back().push_back(record);
+				record.state = car::Simulator::Step(*controller, record.state, kTimestep);
+				record.time = (step + 1) * kTimestep;
+			}
+		}
+		bool passed = recorder.Close();
+
+		std::size_t mismatches = 0;
+		car::TrajectoryReader reader;
+		if (!passed || !reader.Open(kVerifyLogFile) || reader.GetRunCount() != static_cast<int>(runs.size()))
+		{
+			mismatches = 1;
+		}
+		for (int run = 0; mismatches == 0 && run < reader.GetRunCount(); ++run)
+		{
+			const std::vector<car::TrajectoryRecord>& expected = runs[run];
+			std::vector<car::TrajectoryRecord> records;
+			if (reader.GetRecordCount(run) != expected.size() || !reader.ReadRun(run, records) || records.size() != expected.size())
+			{
+				++mismatches;
+				break;
+			}
+			for (std::size_t i = 0; i < expected.size(); ++i)
+			{
+				car::TrajectoryRecord record;
+				if (!SameRecord(records[i], expected[i]) || !reader.Read(run, i, record) || !SameRecord(record, expected[i]) ||
+					reader.Find(run, expected[i].time) != i)
+				{
+					++mismatches;
+				}
+			}
+		}
+		reader.Close();
+		std::remove(kVerifyLogFile);
+
+		std::cout << (mismatches == 0 ? "PASS  " : "FAIL  ") << std::left << std::setw(32) << "trajectory round trip" << std::right
+				  << ' ' << recorder.GetRecordCount() << " records in " << runs.size() << " runs, " << mismatches << " mismatched\n";
+		return mismatches == 0;
+	}
+
+	// Verify
+	// OUT:		False if any fast path disagrees with the engine or the log does not round trip
+	bool Verify(const car::FlatController& _compiled, car::SteeringController& _engine)
+	{
+		std::unique_ptr<car::FlatController> flat(_compiled.Clone());
+		const car::ControllerError error = car::CompareControllers(*flat, _engine, kVerifySamples);
+		bool passed = Check("flat", error.maximum <= car::FlatController::kTolerance, error.maximum);
+		passed = VerifyBatch(_compiled, _engine) && passed;
+		passed = VerifySurface(_engine) && passed;
+		passed = VerifyRecording(_compiled) && passed;
+		std::cout << (passed ? "All checks passed" : "Verification FAILED") << std::endl;
+		return passed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	car::FlatController compiled;
+	if (!LoadController(options, compiled))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (options.verify)
+	{
+		std::unique_ptr<car::EngineController> engine;
+		if (!LoadEngineController(options, engine))
+		{
+			return EXIT_FAILURE;
+		}
+		return Verify(compiled, *engine) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (!options.profile.empty())
+	{
+		agn::Profiler::SetThreadName("Main");
+		agn::Profiler::SetEnabled(true);
+	}
+
+	std::vector<Result> results;
+	if (options.scenario.empty() || options.scenario == "single")
+	{
+		std::unique_ptr<car::FlatController> controller(compiled.Clone());
+		results.push_back(RunSingle("single", *controller, kSingleSteps));
+	}
+	if (options.scenario.empty() || options.scenario == "engine")
+	{
+		std::unique_ptr<car::EngineController> controller;
+		if (!LoadEngineController(options, controller))
+		{
+			return EXIT_FAILURE;
+		}
+		results.push_back(RunSingle("engine", *controller, kEngineSteps));
+	}
+	if (options.scenario.empty() || options.scenario == "fleet")
+	{
+		results.push_back(RunFleet(compiled, options.threads));
+	}
+	if (options.scenario.empty() || options.scenario == "export")
+	{
+		Result result;
+		if (!RunExport(compiled, options.threads, result))
+		{
+			return EXIT_FAILURE;
+		}
+		results.push_back(result);
+	}
+	for (Result& result : results)
+	{
+		std::sort(result.latencies.begin(), result.latencies.end());
+	}
+
+	PrintResults(results);
+	if (!options.profile.empty())
+	{
+		agn::Profiler::SetEnabled(false);
+		if (!agn::Profiler::WriteReport(options.profile + ".json") || !agn::Profiler::WriteTrace(options.profile + ".trace.json"))
+		{
+			std::cerr << "Failed to write profile " << options.profile << ".json" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if (!options.json_file.empty() && !WriteJson(options.json_file, results))
+	{
+		std::cerr << "Failed to write " << options.json_file << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!options.baseline_file.empty())
+	{
+		std::map<std::string, double> baseline;
+		if (!ReadBaseline(options.baseline_file, baseline))
+		{
+			std::cerr << "Failed to read baseline " << options.baseline_file << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (!CompareBaseline(results, baseline, options.tolerance))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
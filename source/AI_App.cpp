@@ -1,4 +1,7 @@
 #include "AI_App.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <Agnostic\logger.h>
 using agn::Log;
 #include <Agnostic\string.h>
@@ -7,21 +10,113 @@ using agn::Log;
 namespace
 {
 	sf::Vector2f window_centre;
+
+	// Real time simulation rate. Frames are rendered at whatever rate the window manages.
+	const unsigned kStepRate = 1000;
+	// Up to a quarter of a second of simulation is caught up after a slow frame.
+	const unsigned kMaxCatchUp = kStepRate / 4;
+	// Seconds skipped by each press of the left and right arrows during replay.
+	const double kScrubStep = 1.0;
+
+	// Fleet simulation rate. Every car is stepped each time, so this is far below kStepRate and
+	// frames are blended between steps.
+	const unsigned kFleetStepRate = 100;
+	// Window pixels per unit of displacement, for the single car and the fleet alike.
+	const float kDisplacementScale = 300.0f;
+	// Fleet lanes leave this much room at the top and bottom of the window for the overlays.
+	const float kFleetMargin = 40.0f;
+	// A car counts as centred once both displacement and velocity are within this.
+	const double kCentredTolerance = 0.05;
+
+	// SetOverlay
+	// Replaces _text's string and centres it horizontally against the top or bottom of the window.
+	void SetOverlay(sf::Text& _text, const std::string& _string, bool _bottom)
+	{
+		_text.setString(_string);
+		const float height = _text.getLocalBounds().height;
+		_text.setOrigin(_text.getLocalBounds().width / 2.0f, height);
+		_text.setPosition(window_centre.x, _bottom ? window_centre.y * 2.0f - height : height);
+	}
+
+	car::CarState Blend(const car::CarState& _from, const car::CarState& _to, double _alpha)
+	{
+		car::CarState state;
+		state.displacement = _from.displacement + (_to.displacement - _from.displacement) * _alpha;
+		state.velocity = _from.velocity + (_to.velocity - _from.velocity) * _alpha;
+		state.steering = _from.steering + (_to.steering - _from.steering) * _alpha;
+		return state;
+	}
 }
 
 AI_App::AI_App(sf::RenderWindow& _window) :
 	Application(_window),
-	engine_(new fl::Engine("Fuzzy Car Controller")),
-	rule_block_(new fl::RuleBlock),
+	steering_(nullptr),
+	controller_loaded_(false),
+	surface_size_(0),
+	fleet_size(0),
 	initial(),
+	previous(),
 	current(),
-	paused(false),
-	timestep(0.1f)
-{}
+	simulation_time(0.0),
+	replaying(false),
+	replay_run(0),
+	replay_time(0.0),
+	published_previous(),
+	published_current(),
+	render_previous(),
+	render_current(),
+	published_replay_run(0),
+	render_replay_run(0),
+	published_replay_time(0.0),
+	render_replay_time(0.0),
+	timestep(0.1f),
+	paused(false)
+{
+	SetStepRate(kStepRate);
+	SetMaxCatchUp(kMaxCatchUp);
+}
 
 AI_App::~AI_App()
 {}
 
+AI_App::OverlayValues::OverlayValues()
+{
+	std::fill(values, values + kMaxValues, std::numeric_limits<double>::quiet_NaN());
+}
+
+bool AI_App::OverlayValues::Changed(std::initializer_list<double> _values, int _decimals)
+{
+	const double scale = std::pow(10.0, _decimals);
+	bool changed = false;
+	int i = 0;
+	for (const double value : _values)
+	{
+		if (i == kMaxValues)
+		{
+			break;
+		}
+		const double rounded = std::round(value * scale);
+		// Never equal while still NaN, so the first call always reports a change.
+		if (!(rounded == values[i]))
+		{
+			values[i] = rounded;
+			changed = true;
+		}
+		++i;
+	}
+	return changed;
+}
+
+void AI_App::SetFleetSize(int _cars_per_axis)
+{
+	fleet_size = std::max(_cars_per_axis, 0);
+	if (fleet_size > 0)
+	{
+		SetStepRate(kFleetStepRate);
+		SetMaxCatchUp(kFleetStepRate / 4);
+	}
+}
+
 bool AI_App::Initialize()
 {
 	if (font_.loadFromFile("NovaMono.ttf"))
@@ -53,87 +148,178 @@ bool AI_App::Initialize()
 
 	pause_overlay = sfx::Sprite(window_centre, Global::TextureManager.Load("pause_overlay.png"));
 
-	displacement_ = new fl::InputVariable("Displacement", -1.0f, 1.0f);
-	displacement_->addTerm(new fl::Ramp("FarLeft", -0.500, -1.000));
-	displacement_->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
-	displacement_->addTerm(new fl::Triangle("Centre", -0.200, 0.000, 0.200));
-	displacement_->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
-	displacement_->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
-	engine_->addInputVariable(displacement_);
-
-	velocity_ = new fl::InputVariable("Velocity", -1.0f, 1.0f);
-	velocity_->addTerm(new fl::Ramp("FarLeft", -0.500,-1.000));
-	velocity_->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
-	velocity_->addTerm(new fl::Triangle("Zero", -0.200, 0.000, 0.200));
-	velocity_->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
-	velocity_->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
-	engine_->addInputVariable(velocity_);
-
-	steering_ = new fl::OutputVariable("Steering", -1.0f, 1.0f);
-	steering_->addTerm(new fl::Ramp("FarLeft", -0.500, -1.000));
-	steering_->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
-	steering_->addTerm(new fl::Triangle("Zero", -0.200, 0.000, 0.200));
-	steering_->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
-	steering_->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
-	engine_->addOutputVariable(steering_);
-
-	// Far Left
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is FarLeft then Steering is FarRight", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Left then Steering is FarRight", engine_)); 
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Zero then Steering is FarRight", engine_)); 
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Right then Steering is Right", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is FarRight then Steering is Zero", engine_));
-	
-	// Left
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Left and Velocity is FarLeft then Steering is FarRight", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Left then Steering is FarRight", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Zero then Steering is Right", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Right then Steering is Zero", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Left and Velocity is FarRight then Steering is Left", engine_));
-
-	// Centre
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is FarLeft then Steering is FarRight", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Left then Steering is Right", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Zero then Steering is Zero", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Right then Steering is Left", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is FarRight then Steering is FarLeft", engine_));
-
-	// Right
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Right and Velocity is FarLeft then Steering is Right", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Left then Steering is Zero", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Zero then Steering is Left", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Right then Steering is FarLeft", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is Right and Velocity is FarRight then Steering is FarLeft", engine_));
-
-	// Far Right
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is FarLeft then Steering is Zero", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Left then Steering is Left", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Zero then Steering is FarLeft", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Right then Steering is FarLeft", engine_));
-	rule_block_->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is FarRight then Steering is FarLeft", engine_));
-
-	engine_->addRuleBlock(rule_block_);
-
-	engine_->configure("Minimum", "", "Minimum", "Maximum", "Centroid");
+	fl::Engine* engine = nullptr;
+	if (!controller_file_.empty())
+	{
+		std::string status;
+		engine = car::LoadEngine(controller_file_, &status);
+		controller_loaded_ = engine != nullptr;
+		if (engine)
+		{
+			Log::Message("Controller loaded from " + controller_file_ + ".");
+		}
+		else
+		{
+			Log::Error("Controller file " + controller_file_ + " could not be loaded, using the default controller:\n" + status);
+		}
+	}
+	if (!engine)
+	{
+		engine = car::BuildCarEngine();
+	}
+	controller_.reset(new car::EngineController(engine));
+	steering_ = controller_.get();
+	if (surface_size_ > 0)
+	{
+		if (InitializeSurface())
+		{
+			steering_ = surface_.get();
+		}
+		else
+		{
+			Log::Error("Control surface could not be built, steering with the fuzzy engine instead.");
+		}
+	}
+	integrator_.reset(new car::RK45Integrator());
 
-	std::string status;
-	if (!engine_->isReady(&status))
+	if (!replay_file_.empty())
+	{
+		replaying = reader_.Open(replay_file_) && reader_.GetRunCount() > 0;
+		if (!replaying)
+		{
+			Log::Error("Trajectory log " + replay_file_ + " could not be opened for replay.");
+		}
+	}
+	if (fleet_size > 0 && !replaying && !InitializeFleet())
+	{
+		Log::Error("Fleet could not be created, animating a single car instead.");
+	}
+	if (!record_file_.empty() && !replaying && !fleet_)
 	{
-		throw fl::Exception("Engine not ready.\n"
-							"The following errors were encountered:\n" + status, FL_AT);
+		if (recorder_.Open(record_file_))
+		{
+			Log::Message("Recording trajectories to " + record_file_ + ".");
+		}
+		else
+		{
+			Log::Error("Trajectory log " + record_file_ + " could not be created.");
+		}
 	}
 
 	Log::Message("Setup Successful.");
 	std::cout << std::endl;
 	Log::Message("Welcome to the Fuzzy Car Controller!");
 
-	GetUserConsoleInput();
+	if (replaying)
+	{
+		real_time = true;
+		paused = true;
+		replay_run = 0;
+		Scrub(reader_.GetStartTime(replay_run));
+		Log::Message("Replaying " + std::to_string(reader_.GetRunCount()) + " recorded runs from " + replay_file_ + ".");
+		Log::Message("Press spacebar to pause/unpause the replay.");
+		Log::Message("Press left/right to skip back/forward a second.");
+		Log::Message("Press up/down for the next/previous run.");
+		Log::Message("Press R to restart the run.");
+	}
+	else if (fleet_)
+	{
+		real_time = true;
+		paused = true;
+		Log::Message("Animating " + std::to_string(fleet_->GetCount()) + " cars started from a " +
+					 std::to_string(fleet_size) + "x" + std::to_string(fleet_size) + " grid of initial conditions.");
+		Log::Message("Press spacebar to pause/unpause the animation.");
+		Log::Message("Press R to reset the animation.");
+	}
+	else
+	{
+		GetUserConsoleInput();
+	}
 
 	return true;
 }
 
+bool AI_App::InitializeSurface()
+{
+	// Keyed like the headless runner's --surface-file, so either can reuse the other's tables.
+	const std::uint64_t key = car::ControllerKey(controller_loaded_ ? controller_file_ : std::string(), controller_->GetEngine(), "engine");
+	std::unique_ptr<car::ControlSurface> surface(new car::ControlSurface);
+	const bool loaded = !surface_file_.empty() && surface->Load(surface_file_, key) &&
+		surface->GetDisplacementCount() == surface_size_ && surface->GetVelocityCount() == surface_size_;
+	if (!loaded)
+	{
+		if (!surface->Build(*controller_, surface_size_, surface_size_))
+		{
+			return false;
+		}
+		if (!surface_file_.empty() && !surface->Save(surface_file_, key))
+		{
+			Log::Warning("Control surface could not be saved to " + surface_file_ + ".");
+		}
+	}
+
+	const car::ControllerError error = surface->MeasureError(*controller_, 101);
+	Log::Message("Control surface " + std::to_string(surface_size_) + "x" + std::to_string(surface_size_) +
+				 (loaded ? " loaded from " + surface_file_ : std::string(" sampled from the controller")) +
+				 ", maximum error " + std::to_string(error.maximum) + ".");
+	surface_ = std::move(surface);
+	return true;
+}
+
+bool AI_App::InitializeFleet()
+{
+	car::FlatController compiled;
+	std::string status;
+	bool from_cache = false;
+	// A controller file's compiled tables are cached next to it for the next launch. The default
+	// controller, including the fallback for a file that failed to load, is compiled directly.
+	const bool compiled_ok = controller_loaded_ ?
+		car::LoadCompiled(controller_file_, car::DefaultCacheFile(controller_file_), compiled, &status, &from_cache) :
+		compiled.Compile(*controller_->GetEngine(), &status);
+	if (!compiled_ok)
+	{
+		Log::Error("Controller could not be flattened for the fleet:\n" + status);
+		return false;
+	}
+	if (from_cache)
+	{
+		Log::Message("Fleet controller loaded from " + car::DefaultCacheFile(controller_file_) + ".");
+	}
+	else if (!status.empty())
+	{
+		Log::Warning(status);
+	}
+	if (!fleet_renderer_.Initialize(*car_.getTexture(), *steering_indicator_.getTexture()))
+	{
+		Log::Error("Fleet texture atlas could not be created.");
+		return false;
+	}
+
+	fleet_.reset(new car::Fleet(compiled));
+	fleet_->Reset(car::Simulator::Grid(-1.0, 1.0, fleet_size, -1.0, 1.0, fleet_size));
+	fleet_renderer_.SetLayout(sf::FloatRect(0.0f, kFleetMargin, static_cast<float>(window_.getSize().x),
+											window_.getSize().y - kFleetMargin * 2.0f),
+							  fleet_->GetCount(), kDisplacementScale);
+	fleet_published.time = fleet_render.time = 0.0;
+	fleet_published.centred = fleet_render.centred = 0;
+	return true;
+}
+
 void AI_App::CleanUp()
 {
+	if (recorder_.IsOpen())
+	{
+		const std::uint64_t records = recorder_.GetRecordCount();
+		if (recorder_.Close())
+		{
+			Log::Message("Recorded " + std::to_string(records) + " steps to " + record_file_ + ".");
+		}
+		else
+		{
+			Log::Error("Writing trajectory log " + record_file_ + " failed.");
+		}
+	}
+	reader_.Close();
 }
 
 void AI_App::ProcessEvent(sf::Event& _event)
@@ -149,7 +335,6 @@ void AI_App::GetUserConsoleInput()
 		Log::Error("Displacement is invalid. Enter a displacement between -1 and 1: ");
 		std::cin >> initial.displacement;
 	}
-	displacement_->setInputValue(initial.displacement);
 
 	Log::Message("Choose a velocity between -1 and 1 : ");
 	std::cin >> initial.velocity;
@@ -158,15 +343,15 @@ void AI_App::GetUserConsoleInput()
 		Log::Error("Velocity is invalid. Enter a velocity between -1 and 1: ");
 		std::cin >> initial.velocity;
 	}
-	velocity_->setInputValue(initial.velocity);
 
-	engine_->process();
-	initial.steering = steering_->getOutputValue();
+	initial = car::Simulator::Initialize(*steering_, initial.displacement, initial.velocity);
 
 	Log::Message("Engine initilization completed. Ready to run.");
 	current = initial;
-
-	UpdateGraphicsObjects();
+	previous = initial;
+	simulation_time = 0.0;
+	recorder_.BeginRun();
+	RecordStep();
 
 	std::string answer;
 	Log::Message("Animate car continuous or discretely? (C/D)");
@@ -196,7 +381,7 @@ void AI_App::GetUserConsoleInput()
 		Log::Message("Press spacebar to step forward the animation.");
 		Log::Message("Default timestep is 0.1.");
 		Log::Message("Press T to increase timestep by 0.1.");
-		Log::Message("Press F to decrease timestep by 0.1.");
+		Log::Message("Press F to decrease timestep by 0.1, down to 0.1.");
 		Log::Message("Press R to reset the animation.");
 		Log::Message("Press S to restart with new input values.");
 	}
@@ -223,41 +408,110 @@ bool AI_App::ConvertAnswerToBool(std::string & _user_input)
 	return answer;
 }
 
-void AI_App::UpdateGraphicsObjects()
+void AI_App::UpdateGraphicsObjects(const car::CarState& _state)
 {
-	car_.setPosition(window_centre.x + current.displacement * 300.0f, car_.getPosition().y);
-	car_.setRotation(current.velocity * 90.0f);
+	car_.setPosition(window_centre.x + _state.displacement * kDisplacementScale, car_.getPosition().y);
+	car_.setRotation(_state.velocity * 90.0f);
 
 	steering_indicator_.setPosition(car_.getPosition());
-	steering_indicator_.setRotation(current.steering * 90.0f);
+	steering_indicator_.setRotation(_state.steering * 90.0f);
 
-	std::string output;
-	output.append("Displacement: " + agn::to_string_precise(current.displacement, 3));
-	output.append(" Velocity: " + agn::to_string_precise(current.velocity, 3));
-	output.append(" Steering: " + agn::to_string_precise(current.steering, 3));
-	output_.setString(output);
+	if (output_values.Changed({ _state.displacement, _state.velocity, _state.steering }, 3))
+	{
+		std::string output;
+		output.append("Displacement: " + agn::to_string_precise(_state.displacement, 3));
+		output.append(" Velocity: " + agn::to_string_precise(_state.velocity, 3));
+		output.append(" Steering: " + agn::to_string_precise(_state.steering, 3));
+		SetOverlay(output_, output, true);
+	}
 }
 
-bool AI_App::Update()
+void AI_App::RecordStep()
 {
-	auto delta_time = clock_.getLastFrameTime();
+	const car::TrajectoryRecord record = { simulation_time, current };
+	recorder_.Record(record);
+	Log::Diagnostic("step", { simulation_time, current.displacement, current.velocity, current.steering });
+}
 
-	if(real_time)
+void AI_App::Scrub(double _time)
+{
+	replay_time = std::min(std::max(_time, reader_.GetStartTime(replay_run)), reader_.GetEndTime(replay_run));
+	car::TrajectoryRecord record;
+	if (reader_.Read(replay_run, reader_.Find(replay_run, replay_time), record))
+	{
+		current = record.state;
+	}
+}
+
+bool AI_App::FixedUpdate(sf::Time _step)
+{
+	// Real time mode advances by the fixed step only, so runs are identical at any frame rate.
+	previous = current;
+	if (fleet_)
 	{
 		if (!paused)
 		{
-			current.velocity += current.steering * delta_time.asSeconds();
-			velocity_->setInputValue(current.velocity);
+			fleet_->Step(_step.asSeconds());
+		}
+	}
+	else if (replaying && !paused)
+	{
+		Scrub(replay_time + _step.asSeconds());
+	}
+	else if (real_time && !paused)
+	{
+		current = car::Simulator::Step(*steering_, current, _step.asSeconds());
+		simulation_time += _step.asSeconds();
+		RecordStep();
+	}
+	return true;
+}
 
-			current.displacement += current.velocity * delta_time.asSeconds();
-			displacement_->setInputValue(current.displacement);
+void AI_App::PublishSnapshot()
+{
+	published_previous = previous;
+	published_current = current;
+	published_replay_run = replay_run;
+	published_replay_time = replay_time;
+	if (fleet_)
+	{
+		// While paused the last step is held still rather than blended towards.
+		fleet_published.previous = paused ? fleet_->GetCurrent() : fleet_->GetPrevious();
+		fleet_published.current = fleet_->GetCurrent();
+		fleet_published.time = fleet_->GetTime();
+		fleet_published.centred = fleet_->CountCentred(kCentredTolerance);
+	}
+}
 
-			engine_->process();
-			current.steering = steering_->getOutputValue();
+void AI_App::AcquireSnapshot()
+{
+	render_previous = published_previous;
+	render_current = published_current;
+	render_replay_run = published_replay_run;
+	render_replay_time = published_replay_time;
+	if (fleet_)
+	{
+		// Equal sized vectors are copied without reallocating.
+		fleet_render.previous = fleet_published.previous;
+		fleet_render.current = fleet_published.current;
+		fleet_render.time = fleet_published.time;
+		fleet_render.centred = fleet_published.centred;
+	}
+}
 
-			UpdateGraphicsObjects();
-		}
+bool AI_App::Update()
+{
+	if (replaying)
+	{
+		return UpdateReplay();
+	}
+	if (fleet_)
+	{
+		return UpdateFleet();
+	}
 
+	if(real_time)
+	{
 		if (Global::Input.KeyPressed(sf::Keyboard::Space))
 		{
 			paused = !paused;
@@ -267,23 +521,20 @@ bool AI_App::Update()
 	{
 		if (Global::Input.KeyPressed(sf::Keyboard::Space))
 		{
-			current.velocity += current.steering * timestep;
-			velocity_->setInputValue(current.velocity);
-
-			current.displacement += current.velocity * timestep;
-			displacement_->setInputValue(current.displacement);
-
-			engine_->process();
-			current.steering = steering_->getOutputValue();
-
-			UpdateGraphicsObjects();
+			current = integrator_->Advance(*steering_, current, timestep);
+			previous = current;
+			simulation_time += timestep;
+			RecordStep();
 		}
 	}
 
 	if (Global::Input.KeyPressed(sf::Keyboard::R))
 	{
 		current = initial;
-		UpdateGraphicsObjects();
+		previous = initial;
+		simulation_time = 0.0;
+		recorder_.BeginRun();
+		RecordStep();
 	}
 
 	if (Global::Input.KeyPressed(sf::Keyboard::S))
@@ -297,27 +548,94 @@ bool AI_App::Update()
 	}
 	if (Global::Input.KeyPressed(sf::Keyboard::F))
 	{
-		timestep -= 0.1;
+		// Steps must move time forwards, or recorded runs lose the order replay seeks by.
+		timestep = std::max(timestep - 0.1f, 0.1f);
 	}
 	
 	return true;
 }
 
+bool AI_App::UpdateReplay()
+{
+	if (Global::Input.KeyPressed(sf::Keyboard::Space))
+	{
+		paused = !paused;
+	}
+
+	const int run = replay_run;
+	double time = replay_time;
+	if (Global::Input.KeyPressed(sf::Keyboard::Up))
+	{
+		replay_run = (replay_run + 1) % reader_.GetRunCount();
+	}
+	if (Global::Input.KeyPressed(sf::Keyboard::Down))
+	{
+		replay_run = (replay_run + reader_.GetRunCount() - 1) % reader_.GetRunCount();
+	}
+	if (Global::Input.KeyPressed(sf::Keyboard::R) || replay_run != run)
+	{
+		time = reader_.GetStartTime(replay_run);
+	}
+	if (Global::Input.KeyPressed(sf::Keyboard::Left))
+	{
+		time -= kScrubStep;
+	}
+	if (Global::Input.KeyPressed(sf::Keyboard::Right))
+	{
+		time += kScrubStep;
+	}
+
+	if (time != replay_time || replay_run != run)
+	{
+		Scrub(time);
+		previous = current;
+	}
+	return true;
+}
+
+bool AI_App::UpdateFleet()
+{
+	if (Global::Input.KeyPressed(sf::Keyboard::Space))
+	{
+		paused = !paused;
+	}
+	if (Global::Input.KeyPressed(sf::Keyboard::R))
+	{
+		fleet_->Restart();
+	}
+	return true;
+}
+
 void AI_App::Render()
 {
+	if (fleet_)
+	{
+		RenderFleet();
+		return;
+	}
+
+	UpdateGraphicsObjects(Blend(render_previous, render_current, GetInterpolation()));
+
 	window_.draw(line_);
 	window_.draw(car_);
 	window_.draw(steering_indicator_);
-
-	output_.setOrigin(output_.getLocalBounds().width / 2.0f, output_.getLocalBounds().height);
-	output_.setPosition(window_centre.x, window_.getSize().y - (output_.getLocalBounds().height));
 	window_.draw(output_);
 
-	if (!real_time)
+	if (replaying)
 	{
-		timestep_.setString("Timestep: " + agn::to_string_precise(timestep, 1));
-		timestep_.setOrigin(timestep_.getLocalBounds().width / 2.0f, timestep_.getLocalBounds().height);
-		timestep_.setPosition(window_centre.x, (timestep_.getLocalBounds().height));
+		if (timestep_values.Changed({ static_cast<double>(render_replay_run), render_replay_time }, 2))
+		{
+			SetOverlay(timestep_, "Run " + std::to_string(render_replay_run + 1) + "/" + std::to_string(reader_.GetRunCount()) +
+								  " Time: " + agn::to_string_precise(render_replay_time, 2), false);
+		}
+		window_.draw(timestep_);
+	}
+	else if (!real_time)
+	{
+		if (timestep_values.Changed({ timestep }, 1))
+		{
+			SetOverlay(timestep_, "Timestep: " + agn::to_string_precise(timestep, 1), false);
+		}
 		window_.draw(timestep_);
 	}
 
@@ -325,3 +643,22 @@ void AI_App::Render()
 		window_.draw(pause_overlay);
 }
 
+void AI_App::RenderFleet()
+{
+	fleet_renderer_.Update(fleet_render.previous, fleet_render.current, GetInterpolation());
+
+	window_.draw(line_);
+	window_.draw(fleet_renderer_);
+
+	const double count = static_cast<double>(fleet_render.current.displacement.size());
+	if (output_values.Changed({ count, static_cast<double>(fleet_render.centred), fleet_render.time }, 1))
+	{
+		SetOverlay(output_, "Cars: " + std::to_string(fleet_render.current.displacement.size()) +
+							" Centred: " + std::to_string(fleet_render.centred) +
+							" Time: " + agn::to_string_precise(fleet_render.time, 1), true);
+	}
+	window_.draw(output_);
+
+	if (paused)
+		window_.draw(pause_overlay);
+}
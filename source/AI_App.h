@@ -1,7 +1,17 @@
 #pragma once
+#include <initializer_list>
+#include <memory>
 #include <Fuzzylite\fl\Headers.h>
 #include <SFML_Extensions\System\application.h>
 #include <SFML_Extensions\Graphics\sprite.h>
+#include "Controller\control_surface.h"
+#include "Controller\engine_controller.h"
+#include "Controller\controller_loader.h"
+#include "Simulation\simulator.h"
+#include "Recording\trajectory_recorder.h"
+#include "Recording\trajectory_reader.h"
+#include "Simulation\fleet.h"
+#include "Rendering\fleet_renderer.h"
 
 class AI_App : public sfx::Application
 {
@@ -9,36 +19,108 @@ public:
 	AI_App(sf::RenderWindow&);
 	~AI_App();
 
+	// Records every simulated step to a trajectory log, one run per reset or restart.
+	inline void SetRecordFile(const std::string& _file_name) { record_file_ = _file_name; }
+	// Replays a trajectory log instead of asking for initial conditions and running the controller.
+	inline void SetReplayFile(const std::string& _file_name) { replay_file_ = _file_name; }
+	// Loads the controller from an .fll file instead of building the default car controller.
+	inline void SetControllerFile(const std::string& _file_name) { controller_file_ = _file_name; }
+	// Steers the single car from a _points_per_axis squared control surface sampled from the
+	// controller instead of running fuzzy inference every step. Zero steers with the engine.
+	inline void SetSurfaceSize(int _points_per_axis) { surface_size_ = _points_per_axis; }
+	// Loads the control surface from _file_name if it was sampled from the same controller at the
+	// same size, otherwise samples it and saves it there.
+	inline void SetSurfaceFile(const std::string& _file_name) { surface_file_ = _file_name; }
+	// Animates a _cars_per_axis squared grid of initial conditions at once instead of asking for one car.
+	// Must be called before Run().
+	void SetFleetSize(int _cars_per_axis);
+
 private:
 
+	// Values an overlay shows, rounded to the places it shows them, so its text and layout are
+	// only rebuilt when what is on screen would change rather than every frame.
+	struct OverlayValues
+	{
+		OverlayValues();
+		// OUT:		True if any value differs from the last call at _decimals places
+		bool Changed(std::initializer_list<double> _values, int _decimals);
+
+		static const int kMaxValues = 4;
+		double values[kMaxValues];
+	};
+
+	// Fleet state handed to the renderer, like published_previous and published_current.
+	struct FleetSnapshot
+	{
+		car::FleetState previous;
+		car::FleetState current;
+		double time;
+		std::size_t centred;
+	};
+
 	bool Initialize();
 	void CleanUp();
 	bool Update();
+	bool UpdateReplay();
+	bool UpdateFleet();
 	void Render();
 	void ProcessEvent(sf::Event& _event);
 
+	bool FixedUpdate(sf::Time _step);
+	void PublishSnapshot();
+	void AcquireSnapshot();
+
 	void GetUserConsoleInput();
 	bool ConvertAnswerToBool(std::string& _user_input);
 
-	void UpdateGraphicsObjects();
+	void UpdateGraphicsObjects(const car::CarState& _state);
+	bool InitializeSurface();
+	bool InitializeFleet();
+	void RenderFleet();
 
-	fl::Engine* engine_;
+	void RecordStep();
+	// Moves the replay to _time in the current run, clamped to the run.
+	void Scrub(double _time);
 
-	fl::InputVariable* displacement_;
-	fl::InputVariable* velocity_;
+	std::unique_ptr<car::EngineController> controller_;
+	// Control surface sampled from controller_, if one was asked for.
+	std::unique_ptr<car::ControlSurface> surface_;
+	// Steers the single car: surface_ if there is one, otherwise controller_.
+	car::SteeringController* steering_;
+	// Discrete steps can be several tenths of a second, so they are subdivided adaptively.
+	std::unique_ptr<car::Integrator> integrator_;
 
-	fl::OutputVariable* steering_;
+	std::string controller_file_;
+	// False if there was no controller file or it failed to load and the default controller is in use.
+	bool controller_loaded_;
+	int surface_size_;
+	std::string surface_file_;
+	std::string record_file_;
+	std::string replay_file_;
+	car::TrajectoryRecorder recorder_;
+	car::TrajectoryReader reader_;
 
-	fl::RuleBlock* rule_block_;
+	std::unique_ptr<car::Fleet> fleet_;
+	FleetRenderer fleet_renderer_;
+	int fleet_size;
+	FleetSnapshot fleet_published, fleet_render;
 
-	struct Parameters
-	{
-		double displacement;
-		double velocity;
-		double steering;
-	};
-	Parameters initial;
-	Parameters current;
+	// Simulation state, owned by FixedUpdate() and Update().
+	car::CarState initial;
+	car::CarState previous;
+	car::CarState current;
+	double simulation_time;
+
+	bool replaying;
+	int replay_run;
+	double replay_time;
+
+	// Last two steps handed to the renderer, and the copy Render() blends between.
+	car::CarState published_previous, published_current;
+	car::CarState render_previous, render_current;
+	// Replay position handed to the renderer with them, since Scrub() runs in FixedUpdate().
+	int published_replay_run, render_replay_run;
+	double published_replay_time, render_replay_time;
 
 	float timestep;
 
@@ -47,6 +129,8 @@ private:
 
 	sf::Text timestep_;
 	sf::Text output_;
+	OverlayValues timestep_values;
+	OverlayValues output_values;
 	sfx::Sprite line_;
 	sfx::Sprite car_;
 	sfx::Sprite steering_indicator_;
@@ -0,0 +1,521 @@
+#include "batch_controller.h"
+#include <algorithm>
+#include <limits>
+#include <Agnostic/profiler.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CAR_BATCH_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CAR_TARGET_SSE2
+#define CAR_TARGET_AVX
+#else
+#include <cpuid.h>
+#define CAR_TARGET_SSE2 __attribute__((target("sse2")))
+#define CAR_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace car
+{
+	namespace
+	{
+#ifdef CAR_BATCH_X86
+		void CpuId(int _leaf, int _subleaf, unsigned _registers[4])
+		{
+#if defined(_MSC_VER)
+			int registers[4];
+			__cpuidex(registers, _leaf, _subleaf);
+			for (int i = 0; i < 4; ++i)
+			{
+				_registers[i] = static_cast<unsigned>(registers[i]);
+			}
+#else
+			__cpuid_count(_leaf, _subleaf, _registers[0], _registers[1], _registers[2], _registers[3]);
+#endif
+		}
+
+		// True if the operating system saves the AVX register state on context switches.
+		bool OSSupportsAVX()
+		{
+#if defined(_MSC_VER)
+			return (_xgetbv(0) & 0x6) == 0x6;
+#else
+			unsigned eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (eax & 0x6) == 0x6;
+#endif
+		}
+#endif
+	}
+
+	BatchController::BatchController(const FlatController& _compiled) :
+		isa_(DetectISA()),
+		input_count_(_compiled.input_count_),
+		input_offsets_(_compiled.input_offsets_),
+		rule_terms_(_compiled.rule_terms_),
+		rule_outputs_(_compiled.rule_outputs_),
+		rule_weights_(_compiled.rule_weights_),
+		activation_threshold_(_compiled.activation_threshold_),
+		output_term_count_(_compiled.output_term_count_),
+		exact_(_compiled.exact_),
+		output_terms_(_compiled.output_terms_),
+		resolution_(_compiled.resolution_),
+		sample_x_(_compiled.sample_x_),
+		output_membership_(_compiled.output_membership_),
+		output_minimum_(_compiled.output_minimum_),
+		output_maximum_(_compiled.output_maximum_),
+		default_value_(_compiled.default_value_),
+		lock_range_(_compiled.lock_range_)
+	{
+		const double infinity = std::numeric_limits<double>::infinity();
+		for (const FlatController::Trapezoid& trapezoid : _compiled.input_terms_)
+		{
+			Term term;
+			term.height = trapezoid.height;
+			if (trapezoid.a == -infinity)
+			{
+				// Left shoulder (compiled with a = b = -inf): rise is one for any finite x.
+				term.a = 0.0;
+				term.rise_scale = 0.0;
+				term.rise_offset = 1.0;
+			}
+			else if (trapezoid.b > trapezoid.a)
+			{
+				term.a = trapezoid.a;
+				term.rise_scale = 1.0 / (trapezoid.b - trapezoid.a);
+				term.rise_offset = 0.0;
+			}
+			else
+			{
+				// Vertical rising edge: zero below a, full above it.
+				term.a = trapezoid.a;
+				term.rise_scale = std::numeric_limits<double>::max();
+				term.rise_offset = 0.0;
+			}
+			if (trapezoid.d == infinity)
+			{
+				// Right shoulder (c = d = inf): fall is one for any finite x.
+				term.d = 0.0;
+				term.fall_scale = 0.0;
+				term.fall_offset = 1.0;
+			}
+			else if (trapezoid.d > trapezoid.c)
+			{
+				term.d = trapezoid.d;
+				term.fall_scale = 1.0 / (trapezoid.d - trapezoid.c);
+				term.fall_offset = 0.0;
+			}
+			else
+			{
+				term.d = trapezoid.d;
+				term.fall_scale = std::numeric_limits<double>::max();
+				term.fall_offset = 0.0;
+			}
+			input_terms_.push_back(term);
+		}
+
+		// Samples outside every active term's support add exact zeros, so skipping them changes nothing.
+		for (int t = 0; t < output_term_count_; ++t)
+		{
+			const double* membership = &output_membership_[t * resolution_];
+			int begin = 0;
+			int end = resolution_;
+			while (begin < end && membership[begin] == 0.0)
+			{
+				++begin;
+			}
+			while (end > begin && membership[end - 1] == 0.0)
+			{
+				--end;
+			}
+			support_begin_.push_back(begin);
+			support_end_.push_back(end);
+		}
+
+		membership_.assign(input_terms_.size() * kMaxLanes, 0.0);
+		activation_.assign(static_cast<std::size_t>(output_term_count_) * kMaxLanes, 0.0);
+		active_terms_.assign(output_term_count_, 0);
+		lane_activation_.assign(output_term_count_, 0.0);
+		workspace_ = _compiled.workspace_;
+	}
+
+	BatchController::ISA BatchController::DetectISA()
+	{
+#ifdef CAR_BATCH_X86
+		unsigned registers[4];
+		CpuId(1, 0, registers);
+		const bool sse2 = (registers[3] & (1u << 26)) != 0;
+		// The widest kernel only uses 256 bit double precision arithmetic, which is AVX.
+		const bool avx = (registers[2] & (1u << 28)) != 0 && (registers[2] & (1u << 27)) != 0 && OSSupportsAVX();
+
+		if (avx)
+		{
+			return ISA::AVX;
+		}
+		if (sse2)
+		{
+			return ISA::SSE2;
+		}
+#endif
+		return ISA::SCALAR;
+	}
+
+	const char* BatchController::ISAName(ISA _isa)
+	{
+		switch (_isa)
+		{
+		case ISA::AVX:
+			return "AVX";
+		case ISA::SSE2:
+			return "SSE2";
+		default:
+			return "Scalar";
+		}
+	}
+
+	void BatchController::SetISA(ISA _isa)
+	{
+		isa_ = std::min(_isa, DetectISA());
+	}
+
+	void BatchController::Steering(const double* _displacement, const double* _velocity, double* _steering, std::size_t _count)
+	{
+		const double* inputs[2] = { _displacement, _velocity };
+		Evaluate(inputs, _steering, _count);
+	}
+
+	void BatchController::Evaluate(const double* const* _inputs, double* _output, std::size_t _count)
+	{
+		// The kernels interleave the inference stages per lane, so a call is timed as a whole.
+		AGN_PROFILE_SCOPE("controller.batch");
+		AGN_PROFILE_COUNT("controller.batch_cars", _count);
+		switch (isa_)
+		{
+#ifdef CAR_BATCH_X86
+		case ISA::AVX:
+			EvaluateAVX(_inputs, _output, _count);
+			break;
+		case ISA::SSE2:
+			EvaluateSSE2(_inputs, _output, _count);
+			break;
+#endif
+		default:
+			EvaluateScalar(_inputs, _output, 0, _count);
+			break;
+		}
+	}
+
+	void BatchController::EvaluateScalar(const double* const* _inputs, double* _output, std::size_t _begin, std::size_t _end)
+	{
+		const int rule_count = static_cast<int>(rule_outputs_.size());
+
+		for (std::size_t car = _begin; car < _end; ++car)
+		{
+			for (int i = 0; i < input_count_; ++i)
+			{
+				const double x = _inputs[i][car];
+				for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+				{
+					const Term& term = input_terms_[t];
+					const double rise = (x - term.a) * term.rise_scale + term.rise_offset;
+					const double fall = (term.d - x) * term.fall_scale + term.fall_offset;
+					membership_[t] = std::max(std::min(std::min(rise, fall), 1.0), 0.0) * term.height;
+				}
+			}
+
+			std::fill(activation_.begin(), activation_.begin() + output_term_count_, 0.0);
+			const int* terms = rule_terms_.data();
+			for (int r = 0; r < rule_count; ++r, terms += input_count_)
+			{
+				double degree = 1.0;
+				for (int i = 0; i < input_count_; ++i)
+				{
+					if (terms[i] >= 0)
+					{
+						degree = std::min(degree, membership_[terms[i]]);
+					}
+				}
+				degree *= rule_weights_[r];
+				if (degree >= activation_threshold_)
+				{
+					activation_[rule_outputs_[r]] = std::max(activation_[rule_outputs_[r]], degree);
+				}
+			}
+
+			if (exact_)
+			{
+				_output[car] = ExactLane(activation_.data(), 1);
+				continue;
+			}
+
+			int active_count = 0;
+			int begin = resolution_;
+			int end = 0;
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				if (activation_[t] > 0.0)
+				{
+					active_terms_[active_count++] = t;
+					begin = std::min(begin, support_begin_[t]);
+					end = std::max(end, support_end_[t]);
+				}
+			}
+
+			double result = default_value_;
+			if (active_count > 0)
+			{
+				double moment = 0.0;
+				double area = 0.0;
+				for (int s = begin; s < end; ++s)
+				{
+					double y = 0.0;
+					for (int k = 0; k < active_count; ++k)
+					{
+						const int t = active_terms_[k];
+						y = std::max(y, std::min(output_membership_[t * resolution_ + s], activation_[t]));
+					}
+					moment += y * sample_x_[s];
+					area += y;
+				}
+				result = moment / area;
+			}
+			if (lock_range_)
+			{
+				result = std::max(std::min(result, output_maximum_), output_minimum_);
+			}
+			_output[car] = result;
+		}
+	}
+
+	double BatchController::ExactLane(const double* _activation, int _stride)
+	{
+		bool fired = false;
+		for (int t = 0; t < output_term_count_; ++t)
+		{
+			lane_activation_[t] = _activation[t * _stride];
+			fired = fired || lane_activation_[t] > 0.0;
+		}
+
+		double result = default_value_;
+		if (fired)
+		{
+			result = ExactCentroid::Integrate(output_terms_.data(), lane_activation_.data(), output_term_count_,
+											  output_minimum_, output_maximum_, workspace_);
+		}
+		if (lock_range_)
+		{
+			result = std::max(std::min(result, output_maximum_), output_minimum_);
+		}
+		return result;
+	}
+
+#ifdef CAR_BATCH_X86
+	CAR_TARGET_SSE2 void BatchController::EvaluateSSE2(const double* const* _inputs, double* _output, std::size_t _count)
+	{
+		const int lanes = 2;
+		const int rule_count = static_cast<int>(rule_outputs_.size());
+		const __m128d zero = _mm_setzero_pd();
+		const __m128d one = _mm_set1_pd(1.0);
+		const __m128d threshold = _mm_set1_pd(activation_threshold_);
+		double* membership = membership_.data();
+		double* activation = activation_.data();
+
+		std::size_t car = 0;
+		for (; car + lanes <= _count; car += lanes)
+		{
+			// Fuzzification
+			for (int i = 0; i < input_count_; ++i)
+			{
+				const __m128d x = _mm_loadu_pd(_inputs[i] + car);
+				for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+				{
+					const Term& term = input_terms_[t];
+					const __m128d rise = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(x, _mm_set1_pd(term.a)), _mm_set1_pd(term.rise_scale)), _mm_set1_pd(term.rise_offset));
+					const __m128d fall = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_set1_pd(term.d), x), _mm_set1_pd(term.fall_scale)), _mm_set1_pd(term.fall_offset));
+					const __m128d degree = _mm_max_pd(_mm_min_pd(_mm_min_pd(rise, fall), one), zero);
+					_mm_storeu_pd(membership + t * kMaxLanes, _mm_mul_pd(degree, _mm_set1_pd(term.height)));
+				}
+			}
+
+			// Rule activation and accumulation
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				_mm_storeu_pd(activation + t * kMaxLanes, zero);
+			}
+			const int* terms = rule_terms_.data();
+			for (int r = 0; r < rule_count; ++r, terms += input_count_)
+			{
+				__m128d degree = one;
+				for (int i = 0; i < input_count_; ++i)
+				{
+					if (terms[i] >= 0)
+					{
+						degree = _mm_min_pd(degree, _mm_loadu_pd(membership + terms[i] * kMaxLanes));
+					}
+				}
+				degree = _mm_mul_pd(degree, _mm_set1_pd(rule_weights_[r]));
+				degree = _mm_and_pd(degree, _mm_cmpge_pd(degree, threshold));
+				double* out = activation + rule_outputs_[r] * kMaxLanes;
+				_mm_storeu_pd(out, _mm_max_pd(_mm_loadu_pd(out), degree));
+			}
+
+			if (exact_)
+			{
+				for (int lane = 0; lane < lanes; ++lane)
+				{
+					_output[car + lane] = ExactLane(activation + lane, kMaxLanes);
+				}
+				continue;
+			}
+
+			// Only integrate terms active in at least one lane.
+			__m128d fired = zero;
+			int active_count = 0;
+			int begin = resolution_;
+			int end = 0;
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				const __m128d active = _mm_cmpgt_pd(_mm_loadu_pd(activation + t * kMaxLanes), zero);
+				fired = _mm_or_pd(fired, active);
+				if (_mm_movemask_pd(active) != 0)
+				{
+					active_terms_[active_count++] = t;
+					begin = std::min(begin, support_begin_[t]);
+					end = std::max(end, support_end_[t]);
+				}
+			}
+
+			// Centroid
+			__m128d moment = zero;
+			__m128d area = zero;
+			for (int s = begin; s < end; ++s)
+			{
+				__m128d y = zero;
+				for (int k = 0; k < active_count; ++k)
+				{
+					const int t = active_terms_[k];
+					const __m128d degree = _mm_loadu_pd(activation + t * kMaxLanes);
+					y = _mm_max_pd(y, _mm_min_pd(_mm_set1_pd(output_membership_[t * resolution_ + s]), degree));
+				}
+				moment = _mm_add_pd(moment, _mm_mul_pd(y, _mm_set1_pd(sample_x_[s])));
+				area = _mm_add_pd(area, y);
+			}
+
+			__m128d result = _mm_div_pd(moment, area);
+			result = _mm_or_pd(_mm_and_pd(fired, result), _mm_andnot_pd(fired, _mm_set1_pd(default_value_)));
+			if (lock_range_)
+			{
+				result = _mm_max_pd(_mm_min_pd(result, _mm_set1_pd(output_maximum_)), _mm_set1_pd(output_minimum_));
+			}
+			_mm_storeu_pd(_output + car, result);
+		}
+
+		EvaluateScalar(_inputs, _output, car, _count);
+	}
+
+	CAR_TARGET_AVX void BatchController::EvaluateAVX(const double* const* _inputs, double* _output, std::size_t _count)
+	{
+		const int lanes = 4;
+		const int rule_count = static_cast<int>(rule_outputs_.size());
+		const __m256d zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d threshold = _mm256_set1_pd(activation_threshold_);
+		double* membership = membership_.data();
+		double* activation = activation_.data();
+
+		std::size_t car = 0;
+		for (; car + lanes <= _count; car += lanes)
+		{
+			// Fuzzification
+			for (int i = 0; i < input_count_; ++i)
+			{
+				const __m256d x = _mm256_loadu_pd(_inputs[i] + car);
+				for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+				{
+					const Term& term = input_terms_[t];
+					const __m256d rise = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(x, _mm256_set1_pd(term.a)), _mm256_set1_pd(term.rise_scale)), _mm256_set1_pd(term.rise_offset));
+					const __m256d fall = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(term.d), x), _mm256_set1_pd(term.fall_scale)), _mm256_set1_pd(term.fall_offset));
+					const __m256d degree = _mm256_max_pd(_mm256_min_pd(_mm256_min_pd(rise, fall), one), zero);
+					_mm256_storeu_pd(membership + t * kMaxLanes, _mm256_mul_pd(degree, _mm256_set1_pd(term.height)));
+				}
+			}
+
+			// Rule activation and accumulation
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				_mm256_storeu_pd(activation + t * kMaxLanes, zero);
+			}
+			const int* terms = rule_terms_.data();
+			for (int r = 0; r < rule_count; ++r, terms += input_count_)
+			{
+				__m256d degree = one;
+				for (int i = 0; i < input_count_; ++i)
+				{
+					if (terms[i] >= 0)
+					{
+						degree = _mm256_min_pd(degree, _mm256_loadu_pd(membership + terms[i] * kMaxLanes));
+					}
+				}
+				degree = _mm256_mul_pd(degree, _mm256_set1_pd(rule_weights_[r]));
+				degree = _mm256_and_pd(degree, _mm256_cmp_pd(degree, threshold, _CMP_GE_OQ));
+				double* out = activation + rule_outputs_[r] * kMaxLanes;
+				_mm256_storeu_pd(out, _mm256_max_pd(_mm256_loadu_pd(out), degree));
+			}
+
+			if (exact_)
+			{
+				for (int lane = 0; lane < lanes; ++lane)
+				{
+					_output[car + lane] = ExactLane(activation + lane, kMaxLanes);
+				}
+				continue;
+			}
+
+			// Only integrate terms active in at least one lane.
+			__m256d fired = zero;
+			int active_count = 0;
+			int begin = resolution_;
+			int end = 0;
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				const __m256d active = _mm256_cmp_pd(_mm256_loadu_pd(activation + t * kMaxLanes), zero, _CMP_GT_OQ);
+				fired = _mm256_or_pd(fired, active);
+				if (_mm256_movemask_pd(active) != 0)
+				{
+					active_terms_[active_count++] = t;
+					begin = std::min(begin, support_begin_[t]);
+					end = std::max(end, support_end_[t]);
+				}
+			}
+
+			// Centroid
+			__m256d moment = zero;
+			__m256d area = zero;
+			for (int s = begin; s < end; ++s)
+			{
+				__m256d y = zero;
+				for (int k = 0; k < active_count; ++k)
+				{
+					const int t = active_terms_[k];
+					const __m256d degree = _mm256_loadu_pd(activation + t * kMaxLanes);
+					y = _mm256_max_pd(y, _mm256_min_pd(_mm256_set1_pd(output_membership_[t * resolution_ + s]), degree));
+				}
+				moment = _mm256_add_pd(moment, _mm256_mul_pd(y, _mm256_set1_pd(sample_x_[s])));
+				area = _mm256_add_pd(area, y);
+			}
+
+			__m256d result = _mm256_div_pd(moment, area);
+			result = _mm256_blendv_pd(_mm256_set1_pd(default_value_), result, fired);
+			if (lock_range_)
+			{
+				result = _mm256_max_pd(_mm256_min_pd(result, _mm256_set1_pd(output_maximum_)), _mm256_set1_pd(output_minimum_));
+			}
+			_mm256_storeu_pd(_output + car, result);
+		}
+
+		EvaluateScalar(_inputs, _output, car, _count);
+	}
+#endif
+}
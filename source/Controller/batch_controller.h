@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "flat_controller.h"
+
+namespace car
+{
+	// BatchController
+	// Evaluates a compiled FlatController for a structure of arrays block of cars per call.
+	// Membership, rule firing and the Centroid integral run several cars per instruction with
+	// AVX or SSE2 kernels, picked at runtime from what the processor supports, with a scalar
+	// fallback that produces identical results. An ExactCentroid output is integrated per car
+	// in closed form after the vectorised rule evaluation.
+	//
+	// Results match FlatController to rounding error, except for an input exactly on a vertical
+	// term edge (a == b or c == d), where the term's membership is zero instead of its full height
+	// (see Term). The batch is stateless, so an output variable locked to its previous value falls
+	// back to its default value when no rule fires.
+	class BatchController
+	{
+	public:
+
+		enum class ISA { SCALAR, SSE2, AVX };
+
+		// Copies the compiled tables, so _compiled may be modified or destroyed afterwards.
+		explicit BatchController(const FlatController& _compiled);
+
+		// Evaluate
+		// IN:		One array per input variable (engine order), output array and number of cars
+		void Evaluate(const double* const* _inputs, double* _output, std::size_t _count);
+
+		// Steering
+		// Two input form for the car controller.
+		// IN:		Displacement, velocity and steering arrays of _count cars
+		void Steering(const double* _displacement, const double* _velocity, double* _steering, std::size_t _count);
+
+		// SetISA
+		// Requests a kernel. Falls back to the best supported kernel below the request.
+		void SetISA(ISA _isa);
+		inline ISA GetISA() const { return isa_; }
+
+		// DetectISA
+		// OUT:		Widest kernel the running processor and operating system support
+		static ISA DetectISA();
+
+		static const char* ISAName(ISA _isa);
+
+	private:
+
+		// Trapezoid membership as min(rise, fall) clamped to [0, 1], times height, where
+		// rise = (x - a) * rise_scale + rise_offset and fall = (d - x) * fall_scale + fall_offset.
+		// Shoulders get a finite breakpoint, zero scale and unit offset in place of their infinite
+		// a or d, so finite inputs never meet an infinity (or inf * 0) in the kernels.
+		// A vertical edge uses the largest finite scale, so exactly at the edge membership
+		// is zero where FlatController gives the full height.
+		struct Term
+		{
+			double a, rise_scale, rise_offset;
+			double d, fall_scale, fall_offset;
+			double height;
+		};
+
+		void EvaluateScalar(const double* const* _inputs, double* _output, std::size_t _begin, std::size_t _end);
+		void EvaluateSSE2(const double* const* _inputs, double* _output, std::size_t _count);
+		void EvaluateAVX(const double* const* _inputs, double* _output, std::size_t _count);
+
+		// ExactLane
+		// IN:		Activation of output term 0 for one car and the distance between terms
+		// OUT:		Exact centroid for that car, or the default value if no rule fired
+		double ExactLane(const double* _activation, int _stride);
+
+		ISA isa_;
+
+		int input_count_;
+		std::vector<Term> input_terms_;
+		std::vector<int> input_offsets_;
+
+		std::vector<int> rule_terms_;
+		std::vector<int> rule_outputs_;
+		std::vector<double> rule_weights_;
+		double activation_threshold_;
+
+		int output_term_count_;
+		bool exact_;
+		std::vector<FlatController::Trapezoid> output_terms_;
+		int resolution_;
+		std::vector<double> sample_x_;
+		std::vector<double> output_membership_;
+		// Samples [support_begin_[t], support_end_[t]) hold every non-zero membership of output term t.
+		std::vector<int> support_begin_;
+		std::vector<int> support_end_;
+
+		double output_minimum_, output_maximum_;
+		double default_value_;
+		bool lock_range_;
+
+		// Per lane scratch, term major: value for term t, lane l is at [t * kMaxLanes + l].
+		static const int kMaxLanes = 4;
+		std::vector<double> membership_;
+		std::vector<double> activation_;
+		std::vector<int> active_terms_;
+		std::vector<double> lane_activation_;
+		ExactCentroid::Workspace workspace_;
+	};
+}
@@ -0,0 +1,227 @@
+#include "control_surface.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace car
+{
+	namespace
+	{
+		const char kMagic[4] = { 'F', 'C', 'C', 'S' };
+		const std::uint32_t kVersion = 2;
+
+		struct FileHeader
+		{
+			char magic[4];
+			std::uint32_t version;
+			std::uint64_t key;
+			std::int32_t displacement_count;
+			std::int32_t velocity_count;
+			double displacement_min, displacement_max;
+			double velocity_min, velocity_max;
+		};
+
+		// Catmull-Rom spline through p1 and p2 at parameter t in [0, 1].
+		inline double CatmullRom(double _p0, double _p1, double _p2, double _p3, double _t)
+		{
+			return _p1 + 0.5 * _t * (_p2 - _p0 + _t * (2.0 * _p0 - 5.0 * _p1 + 4.0 * _p2 - _p3 + _t * (3.0 * (_p1 - _p2) + _p3 - _p0)));
+		}
+
+		// Splits a finite grid coordinate into a cell index and fraction so that
+		// index and index + 1 are always valid nodes.
+		inline int Cell(double _f, int _count, double& _t)
+		{
+			int i = static_cast<int>(_f);
+			if (i > _count - 2)
+			{
+				i = _count - 2;
+			}
+			else if (i < 0)
+			{
+				i = 0;
+			}
+			_t = _f - i;
+			return i;
+		}
+	}
+
+	ControlSurface::ControlSurface() :
+		interpolation_(INTERPOLATION::BILINEAR),
+		displacement_count_(0),
+		velocity_count_(0),
+		displacement_min_(0.0), displacement_max_(0.0),
+		velocity_min_(0.0), velocity_max_(0.0),
+		displacement_scale_(0.0),
+		velocity_scale_(0.0)
+	{}
+
+	void ControlSurface::SetLayout(int _displacement_count, int _velocity_count,
+								   double _displacement_min, double _displacement_max,
+								   double _velocity_min, double _velocity_max)
+	{
+		displacement_count_ = _displacement_count;
+		velocity_count_ = _velocity_count;
+		displacement_min_ = _displacement_min;
+		displacement_max_ = _displacement_max;
+		velocity_min_ = _velocity_min;
+		velocity_max_ = _velocity_max;
+		displacement_scale_ = (_displacement_count - 1) / (_displacement_max - _displacement_min);
+		velocity_scale_ = (_velocity_count - 1) / (_velocity_max - _velocity_min);
+	}
+
+	bool ControlSurface::Build(SteeringController& _exact,
+							   int _displacement_count, int _velocity_count,
+							   double _displacement_min, double _displacement_max,
+							   double _velocity_min, double _velocity_max)
+	{
+		if (_displacement_count < 2 || _velocity_count < 2 ||
+			!(_displacement_max > _displacement_min) || !(_velocity_max > _velocity_min))
+		{
+			return false;
+		}
+
+		SetLayout(_displacement_count, _velocity_count, _displacement_min, _displacement_max, _velocity_min, _velocity_max);
+
+		std::vector<double>* values = new std::vector<double>(static_cast<std::size_t>(_displacement_count) * _velocity_count);
+		for (int d = 0; d < _displacement_count; ++d)
+		{
+			const double displacement = _displacement_min + d / displacement_scale_;
+			for (int v = 0; v < _velocity_count; ++v)
+			{
+				const double velocity = _velocity_min + v / velocity_scale_;
+				(*values)[d * _velocity_count + v] = _exact.Steering(displacement, velocity);
+			}
+		}
+		values_.reset(values);
+		return true;
+	}
+
+	ControllerError ControlSurface::MeasureError(SteeringController& _exact, int _samples)
+	{
+		if (!IsBuilt())
+		{
+			ControllerError none = { 0.0, 0.0 };
+			return none;
+		}
+		return CompareControllers(*this, _exact, _samples,
+								  displacement_min_, displacement_max_, velocity_min_, velocity_max_);
+	}
+
+	bool ControlSurface::Save(const std::string& _file_name, std::uint64_t _key) const
+	{
+		if (!IsBuilt())
+		{
+			return false;
+		}
+
+		std::ofstream file(_file_name, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.key = _key;
+		header.displacement_count = displacement_count_;
+		header.velocity_count = velocity_count_;
+		header.displacement_min = displacement_min_;
+		header.displacement_max = displacement_max_;
+		header.velocity_min = velocity_min_;
+		header.velocity_max = velocity_max_;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(values_->data()), values_->size() * sizeof(double));
+		return static_cast<bool>(file);
+	}
+
+	bool ControlSurface::Load(const std::string& _file_name, std::uint64_t _key)
+	{
+		std::ifstream file(_file_name, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+			header.version != kVersion ||
+			header.key != _key ||
+			header.displacement_count < 2 || header.velocity_count < 2 ||
+			!(header.displacement_max > header.displacement_min) ||
+			!(header.velocity_max > header.velocity_min))
+		{
+			return false;
+		}
+
+		std::vector<double>* values = new std::vector<double>(static_cast<std::size_t>(header.displacement_count) * header.velocity_count);
+		if (!file.read(reinterpret_cast<char*>(values->data()), values->size() * sizeof(double)))
+		{
+			delete values;
+			return false;
+		}
+
+		SetLayout(header.displacement_count, header.velocity_count,
+				  header.displacement_min, header.displacement_max,
+				  header.velocity_min, header.velocity_max);
+		values_.reset(values);
+		return true;
+	}
+
+	double ControlSurface::Steering(double _displacement, double _velocity)
+	{
+		// NaN has no cell and would pass through the clamps below.
+		if (std::isnan(_displacement) || std::isnan(_velocity))
+		{
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+		const double displacement = std::min(std::max(_displacement, displacement_min_), displacement_max_);
+		const double velocity = std::min(std::max(_velocity, velocity_min_), velocity_max_);
+		const double fd = (displacement - displacement_min_) * displacement_scale_;
+		const double fv = (velocity - velocity_min_) * velocity_scale_;
+
+		if (interpolation_ == INTERPOLATION::BICUBIC)
+		{
+			return Bicubic(fd, fv);
+		}
+		return Bilinear(fd, fv);
+	}
+
+	double ControlSurface::Bilinear(double _fd, double _fv) const
+	{
+		double td, tv;
+		const int d = Cell(_fd, displacement_count_, td);
+		const int v = Cell(_fv, velocity_count_, tv);
+
+		const double low = At(d, v) + (At(d, v + 1) - At(d, v)) * tv;
+		const double high = At(d + 1, v) + (At(d + 1, v + 1) - At(d + 1, v)) * tv;
+		return low + (high - low) * td;
+	}
+
+	double ControlSurface::Bicubic(double _fd, double _fv) const
+	{
+		double td, tv;
+		const int d = Cell(_fd, displacement_count_, td);
+		const int v = Cell(_fv, velocity_count_, tv);
+
+		// Edge nodes are repeated outside the table.
+		const int vs[4] = { std::max(v - 1, 0), v, v + 1, std::min(v + 2, velocity_count_ - 1) };
+		double rows[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			const int row = std::min(std::max(d - 1 + i, 0), displacement_count_ - 1);
+			rows[i] = CatmullRom(At(row, vs[0]), At(row, vs[1]), At(row, vs[2]), At(row, vs[3]), tv);
+		}
+		return CatmullRom(rows[0], rows[1], rows[2], rows[3], td);
+	}
+
+	ControlSurface* ControlSurface::Clone() const
+	{
+		return new ControlSurface(*this);
+	}
+}
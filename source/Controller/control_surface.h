@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "steering_controller.h"
+
+namespace car
+{
+	// ControlSurface
+	// Precompiled lookup table of a two input controller. The exact controller is
+	// sampled once on a regular grid and steering is then interpolated from the grid,
+	// replacing a full fuzzy inference per step with a handful of loads and multiplies.
+	// Inputs outside the sampled range are clamped to its edge, which is exact for the
+	// car controller since its outer terms saturate. A NaN input steers NaN, as the car
+	// controller's engine does with its default value of nan.
+	class ControlSurface : public SteeringController
+	{
+	public:
+
+		enum class INTERPOLATION { BILINEAR, BICUBIC };
+
+		ControlSurface();
+
+		// Build
+		// Samples _exact on a _displacement_count x _velocity_count grid spanning the given ranges.
+		// IN:		Exact controller, points per axis (at least 2) and axis ranges
+		// OUT:		False if the resolution or ranges are invalid
+		bool Build(SteeringController& _exact,
+				   int _displacement_count, int _velocity_count,
+				   double _displacement_min = -1.0, double _displacement_max = 1.0,
+				   double _velocity_min = -1.0, double _velocity_max = 1.0);
+
+		// MeasureError
+		// Compares the interpolated surface against _exact on a _samples x _samples grid.
+		// Choosing _samples so the grid does not line up with the table exercises cell interiors.
+		// OUT:		Maximum and mean absolute steering error
+		ControllerError MeasureError(SteeringController& _exact, int _samples);
+
+		// Save
+		// Writes the table to a binary file (header, then row major doubles in native byte order),
+		// tagged with _key identifying the controller it was sampled from (e.g. a ContentHash()).
+		bool Save(const std::string& _file_name, std::uint64_t _key) const;
+
+		// Load
+		// Reads a table written by Save(). Leaves this surface unchanged on failure, including
+		// when the table was saved with a different key, i.e. sampled from another controller.
+		bool Load(const std::string& _file_name, std::uint64_t _key);
+
+		double Steering(double _displacement, double _velocity) override;
+		ControlSurface* Clone() const override;
+
+		inline void SetInterpolation(INTERPOLATION _interpolation) { interpolation_ = _interpolation; }
+		inline INTERPOLATION GetInterpolation() const { return interpolation_; }
+		inline int GetDisplacementCount() const { return displacement_count_; }
+		inline int GetVelocityCount() const { return velocity_count_; }
+		inline bool IsBuilt() const { return static_cast<bool>(values_); }
+
+	private:
+
+		void SetLayout(int _displacement_count, int _velocity_count,
+					   double _displacement_min, double _displacement_max,
+					   double _velocity_min, double _velocity_max);
+
+		inline double At(int _d, int _v) const { return (*values_)[_d * velocity_count_ + _v]; }
+
+		double Bilinear(double _fd, double _fv) const;
+		double Bicubic(double _fd, double _fv) const;
+
+		INTERPOLATION interpolation_;
+
+		int displacement_count_;
+		int velocity_count_;
+		double displacement_min_, displacement_max_;
+		double velocity_min_, velocity_max_;
+		double displacement_scale_;
+		double velocity_scale_;
+
+		// Shared between clones, the table is immutable once built.
+		std::shared_ptr<const std::vector<double>> values_;
+	};
+}
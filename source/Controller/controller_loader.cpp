@@ -0,0 +1,142 @@
+#include "controller_loader.h"
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include "exact_centroid.h"
+
+namespace car
+{
+	namespace
+	{
+		void AddStatus(std::string* _status, const std::string& _message)
+		{
+			if (_status)
+			{
+				_status->append("- " + _message + "\n");
+			}
+		}
+
+		bool ReadText(const std::string& _file_name, std::string& _text)
+		{
+			std::ifstream file(_file_name, std::ios::binary);
+			if (!file)
+			{
+				return false;
+			}
+			std::ostringstream text;
+			text << file.rdbuf();
+			_text = text.str();
+			return true;
+		}
+	}
+
+	fl::Engine* LoadEngine(const std::string& _file_name, std::string* _status)
+	{
+		std::string fll;
+		if (!ReadText(_file_name, fll))
+		{
+			AddStatus(_status, "Controller file <" + _file_name + "> could not be read.");
+			return nullptr;
+		}
+		return ImportEngine(fll, _status);
+	}
+
+	fl::Engine* ImportEngine(const std::string& _fll, std::string* _status)
+	{
+		ExactCentroid::Register();
+		std::unique_ptr<fl::Engine> engine;
+		try
+		{
+			engine.reset(fl::FllImporter().fromString(_fll));
+		}
+		catch (const fl::Exception& e)
+		{
+			AddStatus(_status, std::string("Controller could not be imported: ") + e.what());
+			return nullptr;
+		}
+
+		std::string errors;
+		if (!engine || !engine->isReady(&errors))
+		{
+			AddStatus(_status, "Engine not ready.");
+			if (_status)
+			{
+				_status->append(errors);
+			}
+			return nullptr;
+		}
+		return engine.release();
+	}
+
+	std::uint64_t ContentHash(const std::string& _text)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (const char c : _text)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool HashFile(const std::string& _file_name, std::uint64_t& _hash)
+	{
+		std::string text;
+		if (!ReadText(_file_name, text))
+		{
+			return false;
+		}
+		_hash = ContentHash(text);
+		return true;
+	}
+
+	std::uint64_t ControllerKey(const std::string& _file_name, const fl::Engine* _engine, const std::string& _evaluation)
+	{
+		std::uint64_t hash = 0;
+		if (!_file_name.empty())
+		{
+			HashFile(_file_name, hash);
+		}
+		else if (_engine)
+		{
+			hash = ContentHash(fl::FllExporter().toString(_engine));
+		}
+		return hash ^ ContentHash(_evaluation);
+	}
+
+	bool LoadCompiled(const std::string& _file_name, const std::string& _cache_file_name, FlatController& _controller,
+					  std::string* _status, bool* _from_cache)
+	{
+		if (_from_cache)
+		{
+			*_from_cache = false;
+		}
+
+		std::string fll;
+		if (!ReadText(_file_name, fll))
+		{
+			AddStatus(_status, "Controller file <" + _file_name + "> could not be read.");
+			return false;
+		}
+		const std::uint64_t key = ContentHash(fll);
+		if (!_cache_file_name.empty() && _controller.Load(_cache_file_name, key))
+		{
+			if (_from_cache)
+			{
+				*_from_cache = true;
+			}
+			return true;
+		}
+
+		std::unique_ptr<fl::Engine> engine(ImportEngine(fll, _status));
+		if (!engine || !_controller.Compile(*engine, _status))
+		{
+			return false;
+		}
+		if (!_cache_file_name.empty() && !_controller.Save(_cache_file_name, key))
+		{
+			AddStatus(_status, "Controller cache <" + _cache_file_name + "> could not be written.");
+		}
+		return true;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <fl/Headers.h>
+#include "flat_controller.h"
+
+namespace car
+{
+	// LoadEngine
+	// Reads an engine from a FuzzyLite Language (.fll) file with fl::FllImporter and checks it
+	// with isReady(). ExactCentroid is registered first, so files may name it as the defuzzifier.
+	// IN:		File name, optional string receiving the reasons loading failed
+	// OUT:		Ready to process engine owned by the caller, or null on failure
+	fl::Engine* LoadEngine(const std::string& _file_name, std::string* _status = nullptr);
+
+	// ImportEngine
+	// As LoadEngine() for .fll text already in memory.
+	fl::Engine* ImportEngine(const std::string& _fll, std::string* _status = nullptr);
+
+	// ContentHash
+	// OUT:		64 bit FNV-1a hash of _text, keying compiled caches to the file they were compiled from
+	std::uint64_t ContentHash(const std::string& _text);
+
+	// HashFile
+	// OUT:		False if the file cannot be read, otherwise _hash is the ContentHash() of its contents
+	bool HashFile(const std::string& _file_name, std::uint64_t& _hash);
+
+	// ControllerKey
+	// Identifies a controller for tables sampled from it (see ControlSurface::Save()).
+	// IN:		.fll file the engine was loaded from (empty for none), the engine itself, how it is
+	//			evaluated (e.g. "engine" or "flat")
+	// OUT:		Hash of the file's contents, or of the engine's FLL export without a file, and _evaluation
+	std::uint64_t ControllerKey(const std::string& _file_name, const fl::Engine* _engine, const std::string& _evaluation);
+
+	// LoadCompiled
+	// Compiles the engine in an .fll file into _controller without building an fl::Engine when a
+	// binary cache (see FlatController::Save()) keyed by the file's content hash already exists.
+	// Otherwise the file is imported, validated and compiled, and the cache is rewritten for the
+	// next launch. Workers should Clone() the result rather than load it again.
+	// IN:		.fll file, cache file (empty for none), controller to fill, optional string receiving
+	//			the reasons loading failed (or that the cache could not be written), optional flag
+	//			set to whether the cache was used
+	// OUT:		False if the file cannot be read, imported, validated or compiled
+	bool LoadCompiled(const std::string& _file_name, const std::string& _cache_file_name, FlatController& _controller,
+					  std::string* _status = nullptr, bool* _from_cache = nullptr);
+
+	// Cache file LoadCompiled() callers use for _file_name unless told otherwise.
+	inline std::string DefaultCacheFile(const std::string& _file_name) { return _file_name + ".cache"; }
+}
@@ -0,0 +1,109 @@
+#include "engine_controller.h"
+#include <Agnostic/profiler.h>
+#include "exact_centroid.h"
+
+namespace car
+{
+	fl::Engine* BuildCarEngine()
+	{
+		fl::Engine* engine = new fl::Engine("Fuzzy Car Controller");
+
+		fl::InputVariable* displacement = new fl::InputVariable("Displacement", -1.0f, 1.0f);
+		displacement->addTerm(new fl::Ramp("FarLeft", -0.500, -1.000));
+		displacement->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
+		displacement->addTerm(new fl::Triangle("Centre", -0.200, 0.000, 0.200));
+		displacement->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
+		displacement->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
+		engine->addInputVariable(displacement);
+
+		fl::InputVariable* velocity = new fl::InputVariable("Velocity", -1.0f, 1.0f);
+		velocity->addTerm(new fl::Ramp("FarLeft", -0.500, -1.000));
+		velocity->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
+		velocity->addTerm(new fl::Triangle("Zero", -0.200, 0.000, 0.200));
+		velocity->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
+		velocity->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
+		engine->addInputVariable(velocity);
+
+		fl::OutputVariable* steering = new fl::OutputVariable("Steering", -1.0f, 1.0f);
+		steering->addTerm(new fl::Ramp("FarLeft", -0.500, -1.000));
+		steering->addTerm(new fl::Triangle("Left", -1.000, -0.500, 0.000));
+		steering->addTerm(new fl::Triangle("Zero", -0.200, 0.000, 0.200));
+		steering->addTerm(new fl::Triangle("Right", 0.000, 0.500, 1.000));
+		steering->addTerm(new fl::Ramp("FarRight", 0.500, 1.000));
+		engine->addOutputVariable(steering);
+
+		fl::RuleBlock* rule_block = new fl::RuleBlock;
+
+		// Far Left
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is FarLeft then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Left then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Zero then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is Right then Steering is Right", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarLeft and Velocity is FarRight then Steering is Zero", engine));
+
+		// Left
+		rule_block->addRule(fl::Rule::parse("if Displacement is Left and Velocity is FarLeft then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Left then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Zero then Steering is Right", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Left and Velocity is Right then Steering is Zero", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Left and Velocity is FarRight then Steering is Left", engine));
+
+		// Centre
+		rule_block->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is FarLeft then Steering is FarRight", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Left then Steering is Right", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Zero then Steering is Zero", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is Right then Steering is Left", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Centre and Velocity is FarRight then Steering is FarLeft", engine));
+
+		// Right
+		rule_block->addRule(fl::Rule::parse("if Displacement is Right and Velocity is FarLeft then Steering is Right", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Left then Steering is Zero", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Zero then Steering is Left", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Right and Velocity is Right then Steering is FarLeft", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is Right and Velocity is FarRight then Steering is FarLeft", engine));
+
+		// Far Right
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is FarLeft then Steering is Zero", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Left then Steering is Left", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Zero then Steering is FarLeft", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is Right then Steering is FarLeft", engine));
+		rule_block->addRule(fl::Rule::parse("if Displacement is FarRight and Velocity is FarRight then Steering is FarLeft", engine));
+
+		engine->addRuleBlock(rule_block);
+
+		// Closed form centroid rather than fl::Centroid's fixed resolution sampling.
+		ExactCentroid::Register();
+		engine->configure("Minimum", "", "Minimum", "Maximum", "ExactCentroid");
+
+		std::string status;
+		if (!engine->isReady(&status))
+		{
+			delete engine;
+			throw fl::Exception("Engine not ready.\n"
+								"The following errors were encountered:\n" + status, FL_AT);
+		}
+
+		return engine;
+	}
+
+	EngineController::EngineController(fl::Engine* _engine) :
+		engine_(_engine),
+		displacement_(_engine->getInputVariable(0)),
+		velocity_(_engine->getInputVariable(1)),
+		steering_(_engine->getOutputVariable(0))
+	{}
+
+	double EngineController::Steering(double _displacement, double _velocity)
+	{
+		displacement_->setInputValue(_displacement);
+		velocity_->setInputValue(_velocity);
+		AGN_PROFILE_SCOPE("controller.engine");
+		engine_->process();
+		return steering_->getOutputValue();
+	}
+
+	EngineController* EngineController::Clone() const
+	{
+		return new EngineController(engine_->clone());
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <fl/Headers.h>
+#include "steering_controller.h"
+
+namespace car
+{
+	// BuildCarEngine
+	// Constructs the fuzzy car controller engine (terms, rules and norms).
+	// This is the single place the controller design lives; every other
+	// evaluator is built from the engine this returns.
+	// OUT:		Ready to process engine, owned by the caller
+	// Note:	Throws fl::Exception if the engine fails its isReady() check.
+	fl::Engine* BuildCarEngine();
+
+	// EngineController
+	// Evaluates steering by running the full fuzzylite engine.
+	class EngineController : public SteeringController
+	{
+	public:
+
+		// Takes ownership of _engine. Input 0 is displacement, input 1 velocity and output 0 steering.
+		explicit EngineController(fl::Engine* _engine);
+
+		double Steering(double _displacement, double _velocity) override;
+		EngineController* Clone() const override;
+
+		inline fl::Engine* GetEngine() const { return engine_.get(); }
+
+	private:
+
+		std::unique_ptr<fl::Engine> engine_;
+		fl::InputVariable* displacement_;
+		fl::InputVariable* velocity_;
+		fl::OutputVariable* steering_;
+	};
+}
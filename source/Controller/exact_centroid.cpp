@@ -0,0 +1,360 @@
+#include "exact_centroid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace car
+{
+	namespace
+	{
+		const double kInfinity = std::numeric_limits<double>::infinity();
+
+		// Panels the adaptive fallback starts from, so narrow terms are not stepped over.
+		const int kSeedPanels = 16;
+		const int kMaxDepth = 24;
+
+		bool IsNorm(const fl::Norm* _norm, const std::string& _class_name)
+		{
+			return _norm && _norm->className() == _class_name;
+		}
+
+		struct Integral
+		{
+			double area;
+			double moment;
+		};
+
+		// Adaptive Simpson on [a, b] for the area and moment together, given the membership
+		// at both ends and the midpoint and the whole panel's Simpson estimate.
+		Integral Simpson(const fl::Term* _term, double _a, double _b, double _fa, double _fm, double _fb,
+						 const Integral& _whole, double _tolerance, int _depth)
+		{
+			const double m = 0.5 * (_a + _b);
+			const double lm = 0.5 * (_a + m);
+			const double rm = 0.5 * (m + _b);
+			const double flm = _term->membership(lm);
+			const double frm = _term->membership(rm);
+			const double h = (_b - _a) / 12.0;
+
+			const Integral left = { h * (_fa + 4.0 * flm + _fm), h * (_a * _fa + 4.0 * lm * flm + m * _fm) };
+			const Integral right = { h * (_fm + 4.0 * frm + _fb), h * (m * _fm + 4.0 * rm * frm + _b * _fb) };
+			const double area_error = left.area + right.area - _whole.area;
+			const double moment_error = left.moment + right.moment - _whole.moment;
+
+			if (_depth <= 0 || (std::abs(area_error) <= 15.0 * _tolerance && std::abs(moment_error) <= 15.0 * _tolerance))
+			{
+				// Richardson extrapolation of the two estimates.
+				const Integral result = { left.area + right.area + area_error / 15.0,
+										  left.moment + right.moment + moment_error / 15.0 };
+				return result;
+			}
+
+			const Integral a = Simpson(_term, _a, m, _fa, flm, _fm, left, 0.5 * _tolerance, _depth - 1);
+			const Integral b = Simpson(_term, m, _b, _fm, frm, _fb, right, 0.5 * _tolerance, _depth - 1);
+			const Integral result = { a.area + b.area, a.moment + b.moment };
+			return result;
+		}
+	}
+
+	const double ExactCentroid::kDefaultTolerance = 1e-7;
+
+	ExactCentroid::ExactCentroid(int _resolution, double _tolerance) :
+		fl::Centroid(_resolution),
+		tolerance_(_tolerance)
+	{}
+
+	std::string ExactCentroid::className() const
+	{
+		return "ExactCentroid";
+	}
+
+	ExactCentroid* ExactCentroid::clone() const
+	{
+		return new ExactCentroid(*this);
+	}
+
+	void ExactCentroid::Register()
+	{
+		fl::FactoryManager::instance()->defuzzifier()->registerConstructor("ExactCentroid", &ExactCentroid::Constructor);
+	}
+
+	fl::Defuzzifier* ExactCentroid::Constructor()
+	{
+		return new ExactCentroid;
+	}
+
+	bool ExactCentroid::ToTrapezoid(const fl::Term* _term, Trapezoid& _trapezoid)
+	{
+		_trapezoid.height = _term->getHeight();
+		if (const fl::Triangle* triangle = dynamic_cast<const fl::Triangle*>(_term))
+		{
+			_trapezoid.a = triangle->getVertexA();
+			_trapezoid.b = triangle->getVertexB();
+			_trapezoid.c = triangle->getVertexB();
+			_trapezoid.d = triangle->getVertexC();
+			return true;
+		}
+		if (const fl::Trapezoid* trapezoid = dynamic_cast<const fl::Trapezoid*>(_term))
+		{
+			_trapezoid.a = trapezoid->getVertexA();
+			_trapezoid.b = trapezoid->getVertexB();
+			_trapezoid.c = trapezoid->getVertexC();
+			_trapezoid.d = trapezoid->getVertexD();
+			return true;
+		}
+		if (const fl::Ramp* ramp = dynamic_cast<const fl::Ramp*>(_term))
+		{
+			const double start = ramp->getStart();
+			const double end = ramp->getEnd();
+			if (start < end)
+			{
+				_trapezoid.a = start;
+				_trapezoid.b = end;
+				_trapezoid.c = kInfinity;
+				_trapezoid.d = kInfinity;
+			}
+			else if (start > end)
+			{
+				_trapezoid.a = -kInfinity;
+				_trapezoid.b = -kInfinity;
+				_trapezoid.c = end;
+				_trapezoid.d = start;
+			}
+			else
+			{
+				// fl::Ramp with coincident ends is zero everywhere.
+				_trapezoid.a = _trapezoid.b = _trapezoid.c = _trapezoid.d = start;
+				_trapezoid.height = 0.0;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	double ExactCentroid::Membership(const Trapezoid& _term, double _x)
+	{
+		if (_x >= _term.b && _x <= _term.c)
+		{
+			return _term.height;
+		}
+		if (_x <= _term.a || _x >= _term.d)
+		{
+			return 0.0;
+		}
+		if (_x < _term.b)
+		{
+			return _term.height * (_x - _term.a) / (_term.b - _term.a);
+		}
+		return _term.height * (_term.d - _x) / (_term.d - _term.c);
+	}
+
+	double ExactCentroid::Integrate(const Trapezoid* _terms, const double* _degrees, int _count,
+									double _minimum, double _maximum, Workspace& _workspace)
+	{
+		if (!(_maximum > _minimum))
+		{
+			return fl::nan;
+		}
+
+		// Between consecutive breakpoints every clipped term is a single straight line:
+		// the breakpoints are the range ends, the term vertices and where each edge meets its clip level.
+		std::vector<double>& points = _workspace.breakpoints;
+		points.clear();
+		points.push_back(_minimum);
+		points.push_back(_maximum);
+		for (int t = 0; t < _count; ++t)
+		{
+			const Trapezoid& term = _terms[t];
+			if (!(_degrees[t] > 0.0) || !(term.height > 0.0))
+			{
+				continue;
+			}
+			const double level = std::min(_degrees[t], term.height) / term.height;
+			const double candidates[6] =
+			{
+				term.a, term.b, term.c, term.d,
+				term.a + (term.b - term.a) * level,
+				term.d - (term.d - term.c) * level
+			};
+			for (double x : candidates)
+			{
+				if (x > _minimum && x < _maximum)
+				{
+					points.push_back(x);
+				}
+			}
+		}
+		std::sort(points.begin(), points.end());
+		points.erase(std::unique(points.begin(), points.end()), points.end());
+
+		std::vector<double>& slopes = _workspace.slopes;
+		std::vector<double>& intercepts = _workspace.intercepts;
+		slopes.resize(_count);
+		intercepts.resize(_count);
+
+		double area = 0.0;
+		double moment = 0.0;
+		for (std::size_t p = 0; p + 1 < points.size(); ++p)
+		{
+			const double u = points[p];
+			const double v = points[p + 1];
+			const double mid = 0.5 * (u + v);
+
+			// Line of every term that is non-zero on this interval.
+			int lines = 0;
+			for (int t = 0; t < _count; ++t)
+			{
+				const Trapezoid& term = _terms[t];
+				if (!(_degrees[t] > 0.0) || !(term.height > 0.0) || mid <= term.a || mid >= term.d)
+				{
+					continue;
+				}
+				const double level = std::min(_degrees[t], term.height);
+				double slope = 0.0;
+				double intercept = level;
+				if (mid < term.b)
+				{
+					slope = term.height / (term.b - term.a);
+					intercept = -term.a * slope;
+				}
+				else if (mid > term.c)
+				{
+					slope = -term.height / (term.d - term.c);
+					intercept = -term.d * slope;
+				}
+				if (slope * mid + intercept >= level)
+				{
+					slope = 0.0;
+					intercept = level;
+				}
+				slopes[lines] = slope;
+				intercepts[lines] = intercept;
+				++lines;
+			}
+			if (lines == 0)
+			{
+				continue;
+			}
+
+			// The Maximum of straight lines is convex, so walk its upper envelope from u to v:
+			// the next line on the envelope is the steeper line that overtakes the current one first.
+			int current = 0;
+			for (int k = 1; k < lines; ++k)
+			{
+				const double y = slopes[k] * u + intercepts[k];
+				const double best = slopes[current] * u + intercepts[current];
+				if (y > best || (y == best && slopes[k] > slopes[current]))
+				{
+					current = k;
+				}
+			}
+			double x = u;
+			for (;;)
+			{
+				double next_x = v;
+				int next = -1;
+				for (int k = 0; k < lines; ++k)
+				{
+					if (slopes[k] <= slopes[current])
+					{
+						continue;
+					}
+					const double cross = (intercepts[current] - intercepts[k]) / (slopes[k] - slopes[current]);
+					if (cross > x && (cross < next_x || (cross == next_x && next >= 0 && slopes[k] > slopes[next])))
+					{
+						next_x = cross;
+						next = k;
+					}
+				}
+
+				const double y0 = slopes[current] * x + intercepts[current];
+				const double y1 = slopes[current] * next_x + intercepts[current];
+				const double width = next_x - x;
+				area += 0.5 * (y0 + y1) * width;
+				moment += width / 6.0 * (y0 * (2.0 * x + next_x) + y1 * (x + 2.0 * next_x));
+
+				if (next < 0)
+				{
+					break;
+				}
+				x = next_x;
+				current = next;
+			}
+		}
+
+		return area > 0.0 ? moment / area : fl::nan;
+	}
+
+	fl::scalar ExactCentroid::defuzzify(const fl::Term* _term, fl::scalar _minimum, fl::scalar _maximum) const
+	{
+		if (!fl::Op::isFinite(_minimum) || !fl::Op::isFinite(_maximum))
+		{
+			return fl::nan;
+		}
+
+		// Gather the aggregate as clipped trapezoids if it is one.
+		std::vector<Trapezoid> terms;
+		std::vector<double> degrees;
+		bool linear = true;
+		if (const fl::Accumulated* accumulated = dynamic_cast<const fl::Accumulated*>(_term))
+		{
+			linear = IsNorm(accumulated->getAccumulation(), "Maximum");
+			for (std::size_t i = 0; linear && i < accumulated->terms().size(); ++i)
+			{
+				const fl::Activated* activated = accumulated->terms()[i];
+				Trapezoid trapezoid;
+				double degree = activated->getDegree();
+				linear = ToTrapezoid(activated->getTerm(), trapezoid);
+				if (IsNorm(activated->getActivation(), "AlgebraicProduct"))
+				{
+					// Scaling a trapezoid by the degree gives a shorter, unclipped trapezoid.
+					trapezoid.height *= degree;
+					degree = trapezoid.height;
+				}
+				else if (!IsNorm(activated->getActivation(), "Minimum"))
+				{
+					linear = false;
+				}
+				terms.push_back(trapezoid);
+				degrees.push_back(degree);
+			}
+		}
+		else
+		{
+			Trapezoid trapezoid;
+			linear = ToTrapezoid(_term, trapezoid);
+			terms.push_back(trapezoid);
+			degrees.push_back(trapezoid.height);
+		}
+
+		if (linear)
+		{
+			Workspace workspace;
+			return Integrate(terms.data(), degrees.data(), static_cast<int>(terms.size()), _minimum, _maximum, workspace);
+		}
+		return Adaptive(_term, _minimum, _maximum);
+	}
+
+	double ExactCentroid::Adaptive(const fl::Term* _term, double _minimum, double _maximum) const
+	{
+		const double width = (_maximum - _minimum) / kSeedPanels;
+		Integral total = { 0.0, 0.0 };
+		double a = _minimum;
+		double fa = _term->membership(a);
+		for (int panel = 1; panel <= kSeedPanels; ++panel)
+		{
+			const double b = panel == kSeedPanels ? _maximum : _minimum + panel * width;
+			const double m = 0.5 * (a + b);
+			const double fm = _term->membership(m);
+			const double fb = _term->membership(b);
+			const double h = (b - a) / 6.0;
+			const Integral whole = { h * (fa + 4.0 * fm + fb), h * (a * fa + 4.0 * m * fm + b * fb) };
+			const Integral panel_integral = Simpson(_term, a, b, fa, fm, fb, whole, tolerance_ * (b - a), kMaxDepth);
+			total.area += panel_integral.area;
+			total.moment += panel_integral.moment;
+			a = b;
+			fa = fb;
+		}
+		return total.area > 0.0 ? total.moment / total.area : fl::nan;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fl/Headers.h>
+
+namespace car
+{
+	// ExactCentroid
+	// Centroid defuzzifier that integrates instead of sampling. When the aggregated output is
+	// the Maximum of piecewise linear terms (Triangle, Trapezoid, Ramp) activated by Minimum or
+	// AlgebraicProduct, the area and moment are computed in closed form over the exact segments
+	// of the aggregate, so the result carries no discretisation error. Any other output is
+	// integrated by adaptive Simpson quadrature to within the configured tolerance.
+	//
+	// Registered with fuzzylite's defuzzifier factory as "ExactCentroid" by Register(), so it can
+	// be named anywhere "Centroid" is (Engine::configure(), fll files). It derives from fl::Centroid
+	// so code that accepts a Centroid accepts this too; the resolution is only kept for exporters.
+	class ExactCentroid : public fl::Centroid
+	{
+	public:
+
+		// Membership rises over [a, b], is height over [b, c] and falls over [c, d].
+		// Shoulders use infinite vertices.
+		struct Trapezoid
+		{
+			double a, b, c, d;
+			double height;
+		};
+
+		// Reusable buffers for Integrate(), so repeated calls do not allocate.
+		struct Workspace
+		{
+			std::vector<double> breakpoints;
+			std::vector<double> slopes;
+			std::vector<double> intercepts;
+		};
+
+		static const double kDefaultTolerance;
+
+		explicit ExactCentroid(int _resolution = fl::IntegralDefuzzifier::defaultResolution(),
+							   double _tolerance = kDefaultTolerance);
+
+		std::string className() const override;
+		fl::scalar defuzzify(const fl::Term* _term, fl::scalar _minimum, fl::scalar _maximum) const override;
+		ExactCentroid* clone() const override;
+
+		// Absolute error allowed per unit of range by the adaptive quadrature fallback.
+		inline void SetTolerance(double _tolerance) { tolerance_ = _tolerance; }
+		inline double GetTolerance() const { return tolerance_; }
+
+		// Register
+		// Adds "ExactCentroid" to fl::FactoryManager's defuzzifier factory. Safe to call repeatedly.
+		static void Register();
+		static fl::Defuzzifier* Constructor();
+
+		// ToTrapezoid
+		// IN:		Term to convert
+		// OUT:		False if the term is not a Triangle, Trapezoid or Ramp
+		static bool ToTrapezoid(const fl::Term* _term, Trapezoid& _trapezoid);
+		static double Membership(const Trapezoid& _term, double _x);
+
+		// Integrate
+		// Exact centroid over [_minimum, _maximum] of max_t min(term_t(x), degree_t).
+		// IN:		Terms, activation degree per term (zero skips the term), term count,
+		//			range and buffers to reuse
+		// OUT:		Centroid, or NaN if the aggregate has no area
+		static double Integrate(const Trapezoid* _terms, const double* _degrees, int _count,
+								double _minimum, double _maximum, Workspace& _workspace);
+
+	private:
+
+		double Adaptive(const fl::Term* _term, double _minimum, double _maximum) const;
+
+		double tolerance_;
+	};
+}
@@ -0,0 +1,821 @@
+#include "flat_controller.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <Agnostic/profiler.h>
+
+namespace car
+{
+	namespace
+	{
+		void AddStatus(std::string* _status, const std::string& _message)
+		{
+			if (_status)
+			{
+				_status->append("- " + _message + "\n");
+			}
+		}
+
+		int IndexOf(const std::vector<fl::Term*>& _terms, const fl::Term* _term)
+		{
+			for (std::size_t i = 0; i < _terms.size(); ++i)
+			{
+				if (_terms[i] == _term)
+				{
+					return static_cast<int>(i);
+				}
+			}
+			return -1;
+		}
+
+		// Collects the (input, term) pairs of a conjunction of unhedged propositions.
+		// Writes the term index local to each input into _terms, which must start filled with -1.
+		bool FlattenAntecedent(const fl::Engine& _engine, const fl::Expression* _expression, std::vector<int>& _terms)
+		{
+			if (const fl::Operator* op = dynamic_cast<const fl::Operator*>(_expression))
+			{
+				return op->name == fl::Rule::andKeyword() &&
+					FlattenAntecedent(_engine, op->left, _terms) &&
+					FlattenAntecedent(_engine, op->right, _terms);
+			}
+
+			const fl::Proposition* proposition = dynamic_cast<const fl::Proposition*>(_expression);
+			if (!proposition || !proposition->hedges.empty())
+			{
+				return false;
+			}
+			for (int i = 0; i < _engine.numberOfInputVariables(); ++i)
+			{
+				const fl::InputVariable* input = _engine.getInputVariable(i);
+				if (proposition->variable == input)
+				{
+					const int term = IndexOf(input->terms(), proposition->term);
+					// Each input may only be tested once per rule.
+					if (term < 0 || _terms[i] >= 0)
+					{
+						return false;
+					}
+					_terms[i] = term;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool IsNorm(const fl::Norm* _norm, const std::string& _class_name)
+		{
+			return _norm && _norm->className() == _class_name;
+		}
+
+		const char kMagic[4] = { 'F', 'C', 'F', 'C' };
+		const std::uint32_t kVersion = 2;
+		// Anything larger in a cache is treated as corrupt.
+		const std::int32_t kMaxCount = 1 << 20;
+
+		struct FileHeader
+		{
+			char magic[4];
+			std::uint32_t version;
+			std::uint64_t key;
+			std::int32_t input_count;
+			std::int32_t input_term_count;
+			std::int32_t output_term_count;
+			std::int32_t rule_count;
+			std::int32_t resolution;
+			std::int32_t flags;
+			double activation_threshold;
+			double output_minimum, output_maximum;
+			double default_value;
+		};
+
+		const std::int32_t kExact = 1;
+		const std::int32_t kLockRange = 2;
+		const std::int32_t kLockPrevious = 4;
+
+		template <typename T>
+		void WriteVector(std::ofstream& _file, const std::vector<T>& _values)
+		{
+			if (!_values.empty())
+			{
+				_file.write(reinterpret_cast<const char*>(_values.data()), _values.size() * sizeof(T));
+			}
+		}
+
+		template <typename T>
+		bool ReadVector(std::ifstream& _file, std::vector<T>& _values, std::size_t _count)
+		{
+			_values.resize(_count);
+			return _count == 0 || static_cast<bool>(_file.read(reinterpret_cast<char*>(_values.data()), _count * sizeof(T)));
+		}
+
+		// Strings are stored as a uint32 length followed by the characters.
+		void WriteStrings(std::ofstream& _file, const std::vector<std::string>& _strings)
+		{
+			for (const std::string& text : _strings)
+			{
+				const std::uint32_t length = static_cast<std::uint32_t>(text.size());
+				_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+				_file.write(text.data(), length);
+			}
+		}
+
+		bool ReadStrings(std::ifstream& _file, std::vector<std::string>& _strings, std::size_t _count)
+		{
+			_strings.resize(_count);
+			for (std::string& text : _strings)
+			{
+				std::uint32_t length;
+				if (!_file.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > (1u << 20))
+				{
+					return false;
+				}
+				text.resize(length);
+				if (length > 0 && !_file.read(&text[0], length))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Closed interval outside which a term's membership is zero.
+		inline double SupportBegin(const ExactCentroid::Trapezoid& _term) { return std::min(_term.a, _term.b); }
+		inline double SupportEnd(const ExactCentroid::Trapezoid& _term) { return std::max(_term.c, _term.d); }
+	}
+
+	const double FlatController::kTolerance = 1e-4;
+	const int FlatController::kMaxRuleCells = 1 << 16;
+
+	FlatController::FlatController() :
+		input_count_(0),
+		activation_threshold_(0.0),
+		sparse_(true),
+		output_term_count_(0),
+		exact_(false),
+		resolution_(0),
+		output_minimum_(0.0), output_maximum_(0.0),
+		default_value_(fl::nan),
+		previous_value_(fl::nan),
+		lock_range_(false),
+		lock_previous_(false)
+	{}
+
+	bool FlatController::Compile(const fl::Engine& _engine, std::string* _status)
+	{
+		bool valid = true;
+
+		// Inputs
+		std::vector<Trapezoid> input_terms;
+		std::vector<int> input_offsets(1, 0);
+		std::vector<std::string> variable_names;
+		for (const fl::InputVariable* input : _engine.inputVariables())
+		{
+			variable_names.push_back(input->getName());
+			if (!input->isEnabled())
+			{
+				AddStatus(_status, "Input variable <" + input->getName() + "> is disabled.");
+				valid = false;
+			}
+			for (const fl::Term* term : input->terms())
+			{
+				Trapezoid trapezoid;
+				if (!ExactCentroid::ToTrapezoid(term, trapezoid))
+				{
+					AddStatus(_status, "Term <" + term->getName() + "> of <" + input->getName() + "> is a " + term->className() + ".");
+					valid = false;
+				}
+				input_terms.push_back(trapezoid);
+			}
+			input_offsets.push_back(static_cast<int>(input_terms.size()));
+		}
+		const int input_count = _engine.numberOfInputVariables();
+
+		// Output
+		if (_engine.numberOfOutputVariables() != 1)
+		{
+			AddStatus(_status, "Engine must have exactly one output variable.");
+			return false;
+		}
+		const fl::OutputVariable* output = _engine.getOutputVariable(0);
+		variable_names.push_back(output->getName());
+		if (!output->isEnabled())
+		{
+			AddStatus(_status, "Output variable <" + output->getName() + "> is disabled.");
+			valid = false;
+		}
+		const fl::Centroid* centroid = dynamic_cast<const fl::Centroid*>(output->getDefuzzifier());
+		if (!centroid || centroid->getResolution() < 1)
+		{
+			AddStatus(_status, "Output variable <" + output->getName() + "> must use a Centroid defuzzifier.");
+			return false;
+		}
+		if (!IsNorm(output->fuzzyOutput()->getAccumulation(), "Maximum"))
+		{
+			AddStatus(_status, "Output variable <" + output->getName() + "> must use Maximum accumulation.");
+			valid = false;
+		}
+
+		std::vector<Trapezoid> output_terms;
+		for (const fl::Term* term : output->terms())
+		{
+			Trapezoid trapezoid;
+			if (!ExactCentroid::ToTrapezoid(term, trapezoid))
+			{
+				AddStatus(_status, "Term <" + term->getName() + "> of <" + output->getName() + "> is a " + term->className() + ".");
+				valid = false;
+			}
+			output_terms.push_back(trapezoid);
+		}
+
+		// Rules
+		std::vector<int> rule_terms;
+		std::vector<int> rule_outputs;
+		std::vector<double> rule_weights;
+		std::vector<std::string> rule_text;
+		for (const fl::RuleBlock* block : _engine.ruleBlocks())
+		{
+			if (!block->isEnabled())
+			{
+				continue;
+			}
+			if ((block->getConjunction() && !IsNorm(block->getConjunction(), "Minimum")) ||
+				!IsNorm(block->getActivation(), "Minimum"))
+			{
+				AddStatus(_status, "Rule block <" + block->getName() + "> must use Minimum conjunction and activation.");
+				valid = false;
+			}
+			for (const fl::Rule* rule : block->rules())
+			{
+				if (!rule->isLoaded())
+				{
+					continue;
+				}
+
+				std::vector<int> terms(input_count, -1);
+				if (!FlattenAntecedent(_engine, rule->getAntecedent()->getExpression(), terms))
+				{
+					AddStatus(_status, "Rule <" + rule->getText() + "> is not a conjunction of unhedged input propositions.");
+					valid = false;
+					continue;
+				}
+
+				const std::vector<fl::Proposition*>& conclusions = rule->getConsequent()->conclusions();
+				const int output_term = conclusions.size() == 1 && conclusions[0]->variable == output && conclusions[0]->hedges.empty() ?
+					IndexOf(output->terms(), conclusions[0]->term) : -1;
+				if (output_term < 0)
+				{
+					AddStatus(_status, "Rule <" + rule->getText() + "> must conclude a single unhedged output term.");
+					valid = false;
+					continue;
+				}
+
+				for (int i = 0; i < input_count; ++i)
+				{
+					rule_terms.push_back(terms[i] < 0 ? -1 : input_offsets[i] + terms[i]);
+				}
+				rule_outputs.push_back(output_term);
+				rule_weights.push_back(rule->getWeight());
+				rule_text.push_back(rule->getText());
+			}
+		}
+
+		if (!valid)
+		{
+			return false;
+		}
+
+		input_count_ = input_count;
+		input_terms_.swap(input_terms);
+		input_offsets_.swap(input_offsets);
+		rule_terms_.swap(rule_terms);
+		rule_outputs_.swap(rule_outputs);
+		rule_weights_.swap(rule_weights);
+		rule_text_.swap(rule_text);
+		variable_names_.swap(variable_names);
+		// fl::RuleBlock only activates rules whose degree is greater than zero by more than macheps.
+		activation_threshold_ = fl::fuzzylite::macheps();
+
+		output_term_count_ = static_cast<int>(output_terms.size());
+		output_terms_.swap(output_terms);
+		exact_ = dynamic_cast<const ExactCentroid*>(centroid) != nullptr;
+		resolution_ = exact_ ? 0 : centroid->getResolution();
+		output_minimum_ = output->getMinimum();
+		output_maximum_ = output->getMaximum();
+		default_value_ = output->getDefaultValue();
+		lock_range_ = output->isLockedOutputValueInRange();
+		lock_previous_ = output->isLockedPreviousOutputValue();
+
+		Prepare();
+		return true;
+	}
+
+	bool FlatController::Save(const std::string& _file_name, std::uint64_t _key) const
+	{
+		if (output_term_count_ == 0)
+		{
+			return false;
+		}
+
+		std::ofstream file(_file_name, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.key = _key;
+		header.input_count = input_count_;
+		header.input_term_count = static_cast<std::int32_t>(input_terms_.size());
+		header.output_term_count = output_term_count_;
+		header.rule_count = GetRuleCount();
+		header.resolution = resolution_;
+		header.flags = (exact_ ? kExact : 0) | (lock_range_ ? kLockRange : 0) | (lock_previous_ ? kLockPrevious : 0);
+		header.activation_threshold = activation_threshold_;
+		header.output_minimum = output_minimum_;
+		header.output_maximum = output_maximum_;
+		header.default_value = default_value_;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		WriteVector(file, input_offsets_);
+		WriteVector(file, input_terms_);
+		WriteVector(file, output_terms_);
+		WriteVector(file, rule_terms_);
+		WriteVector(file, rule_outputs_);
+		WriteVector(file, rule_weights_);
+		WriteStrings(file, rule_text_);
+		WriteStrings(file, variable_names_);
+		return static_cast<bool>(file);
+	}
+
+	bool FlatController::Load(const std::string& _file_name, std::uint64_t _key)
+	{
+		std::ifstream file(_file_name, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+			header.version != kVersion ||
+			header.key != _key ||
+			header.input_count < 0 || header.input_count > kMaxCount ||
+			header.input_term_count < 0 || header.input_term_count > kMaxCount ||
+			header.output_term_count < 1 || header.output_term_count > kMaxCount ||
+			header.rule_count < 0 || header.rule_count > kMaxCount ||
+			header.resolution < ((header.flags & kExact) ? 0 : 1) || header.resolution > kMaxCount)
+		{
+			return false;
+		}
+
+		std::vector<int> input_offsets;
+		std::vector<Trapezoid> input_terms, output_terms;
+		std::vector<int> rule_terms, rule_outputs;
+		std::vector<double> rule_weights;
+		if (!ReadVector(file, input_offsets, header.input_count + 1) ||
+			!ReadVector(file, input_terms, header.input_term_count) ||
+			!ReadVector(file, output_terms, header.output_term_count) ||
+			!ReadVector(file, rule_terms, static_cast<std::size_t>(header.rule_count) * header.input_count) ||
+			!ReadVector(file, rule_outputs, header.rule_count) ||
+			!ReadVector(file, rule_weights, header.rule_count))
+		{
+			return false;
+		}
+		std::vector<std::string> rule_text, variable_names;
+		if (!ReadStrings(file, rule_text, header.rule_count) ||
+			!ReadStrings(file, variable_names, header.input_count + 1))
+		{
+			return false;
+		}
+
+		// Every index must land in the table it points into.
+		if (input_offsets.front() != 0 || input_offsets.back() != header.input_term_count)
+		{
+			return false;
+		}
+		for (int i = 0; i < header.input_count; ++i)
+		{
+			if (input_offsets[i] > input_offsets[i + 1])
+			{
+				return false;
+			}
+		}
+		for (int r = 0; r < header.rule_count; ++r)
+		{
+			for (int i = 0; i < header.input_count; ++i)
+			{
+				const int term = rule_terms[r * header.input_count + i];
+				if (term != -1 && (term < input_offsets[i] || term >= input_offsets[i + 1]))
+				{
+					return false;
+				}
+			}
+			if (rule_outputs[r] < 0 || rule_outputs[r] >= header.output_term_count)
+			{
+				return false;
+			}
+		}
+
+		input_count_ = header.input_count;
+		input_terms_.swap(input_terms);
+		input_offsets_.swap(input_offsets);
+		rule_terms_.swap(rule_terms);
+		rule_outputs_.swap(rule_outputs);
+		rule_weights_.swap(rule_weights);
+		rule_text_.swap(rule_text);
+		variable_names_.swap(variable_names);
+		activation_threshold_ = header.activation_threshold;
+		output_term_count_ = header.output_term_count;
+		output_terms_.swap(output_terms);
+		exact_ = (header.flags & kExact) != 0;
+		resolution_ = exact_ ? 0 : header.resolution;
+		output_minimum_ = header.output_minimum;
+		output_maximum_ = header.output_maximum;
+		default_value_ = header.default_value;
+		lock_range_ = (header.flags & kLockRange) != 0;
+		lock_previous_ = (header.flags & kLockPrevious) != 0;
+
+		Prepare();
+		return true;
+	}
+
+	void FlatController::Prepare()
+	{
+		// Tabulate every output term at the fl::Centroid midpoints. ExactCentroid needs no samples.
+		const double dx = (output_maximum_ - output_minimum_) / resolution_;
+		sample_x_.resize(resolution_);
+		output_membership_.resize(static_cast<std::size_t>(output_term_count_) * resolution_);
+		for (int s = 0; s < resolution_; ++s)
+		{
+			sample_x_[s] = output_minimum_ + (s + 0.5) * dx;
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				output_membership_[t * resolution_ + s] = ExactCentroid::Membership(output_terms_[t], sample_x_[s]);
+			}
+		}
+
+		sample_begin_.assign(output_term_count_, resolution_);
+		sample_end_.assign(output_term_count_, 0);
+		output_support_.resize(2 * output_term_count_);
+		for (int t = 0; t < output_term_count_; ++t)
+		{
+			for (int s = 0; s < resolution_; ++s)
+			{
+				if (output_membership_[t * resolution_ + s] > 0.0)
+				{
+					sample_begin_[t] = std::min(sample_begin_[t], s);
+					sample_end_[t] = s + 1;
+				}
+			}
+			output_support_[2 * t] = SupportBegin(output_terms_[t]);
+			output_support_[2 * t + 1] = SupportEnd(output_terms_[t]);
+		}
+
+		previous_value_ = fl::nan;
+		membership_.assign(input_terms_.size(), 0.0);
+		activation_.assign(output_term_count_, 0.0);
+		aggregated_.assign(resolution_, 0.0);
+		workspace_.breakpoints.reserve(6 * output_terms_.size() + 2);
+		workspace_.slopes.reserve(output_terms_.size());
+		workspace_.intercepts.reserve(output_terms_.size());
+		BuildIndex();
+	}
+
+	void FlatController::BuildIndex()
+	{
+		const double infinity = std::numeric_limits<double>::infinity();
+
+		// Interval index. Within one elementary interval no term starts or ends, so the same terms
+		// can be non-zero anywhere in it. Infinite shoulder ends split nothing and are left out.
+		interval_bounds_.clear();
+		bound_offsets_.assign(1, 0);
+		interval_offsets_.assign(1, 0);
+		interval_term_offsets_.assign(1, 0);
+		interval_terms_.clear();
+		for (int i = 0; i < input_count_; ++i)
+		{
+			std::vector<double> bounds;
+			for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+			{
+				for (const double bound : { SupportBegin(input_terms_[t]), SupportEnd(input_terms_[t]) })
+				{
+					if (std::abs(bound) < infinity)
+					{
+						bounds.push_back(bound);
+					}
+				}
+			}
+			std::sort(bounds.begin(), bounds.end());
+			bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+			// std::upper_bound puts x in interval k when bounds[k - 1] <= x < bounds[k].
+			const int bound_count = static_cast<int>(bounds.size());
+			for (int k = 0; k <= bound_count; ++k)
+			{
+				const double lower = k > 0 ? bounds[k - 1] : -infinity;
+				const double upper = k < bound_count ? bounds[k] : infinity;
+				for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+				{
+					// A vertical edge is non-zero exactly at its end, so the support is closed.
+					if (SupportBegin(input_terms_[t]) < upper && SupportEnd(input_terms_[t]) >= lower)
+					{
+						interval_terms_.push_back(t);
+					}
+				}
+				interval_term_offsets_.push_back(static_cast<int>(interval_terms_.size()));
+			}
+			interval_bounds_.insert(interval_bounds_.end(), bounds.begin(), bounds.end());
+			bound_offsets_.push_back(static_cast<int>(interval_bounds_.size()));
+			interval_offsets_.push_back(interval_offsets_.back() + bound_count + 1);
+		}
+
+		// Rule index, bucketing rules by the combination of terms they test.
+		cell_strides_.resize(input_count_);
+		cell_offsets_.clear();
+		cell_rules_.clear();
+		input_untested_.assign(input_count_, 0);
+		long long cell_count = 1;
+		for (int i = 0; i < input_count_; ++i)
+		{
+			cell_strides_[i] = static_cast<int>(cell_count);
+			cell_count *= input_offsets_[i + 1] - input_offsets_[i] + 1;
+			if (cell_count > kMaxRuleCells)
+			{
+				return;
+			}
+		}
+
+		const int rule_count = GetRuleCount();
+		std::vector<int> rule_cells(rule_count, 0);
+		cell_offsets_.assign(static_cast<std::size_t>(cell_count) + 1, 0);
+		for (int r = 0; r < rule_count; ++r)
+		{
+			for (int i = 0; i < input_count_; ++i)
+			{
+				const int term = rule_terms_[r * input_count_ + i];
+				const int choice = term >= 0 ? term - input_offsets_[i] : input_offsets_[i + 1] - input_offsets_[i];
+				input_untested_[i] |= term < 0 ? 1 : 0;
+				rule_cells[r] += choice * cell_strides_[i];
+			}
+			++cell_offsets_[rule_cells[r] + 1];
+		}
+		for (std::size_t c = 1; c < cell_offsets_.size(); ++c)
+		{
+			cell_offsets_[c] += cell_offsets_[c - 1];
+		}
+		cell_rules_.resize(rule_count);
+		std::vector<int> filled(cell_offsets_.begin(), cell_offsets_.end() - 1);
+		for (int r = 0; r < rule_count; ++r)
+		{
+			cell_rules_[filled[rule_cells[r]]++] = r;
+		}
+
+		// Each input has at most its term count plus the untested marker as choices.
+		active_choices_.assign(input_terms_.size() + input_count_, 0);
+		active_counts_.assign(input_count_, 0);
+		active_positions_.assign(input_count_, 0);
+		active_rules_.assign(rule_count, 0);
+	}
+
+	void FlatController::Fuzzify(const double* _inputs)
+	{
+		for (int i = 0; i < input_count_; ++i)
+		{
+			for (int t = input_offsets_[i]; t < input_offsets_[i + 1]; ++t)
+			{
+				membership_[t] = ExactCentroid::Membership(input_terms_[t], _inputs[i]);
+			}
+		}
+	}
+
+	int FlatController::FuzzifySparse(const double* _inputs)
+	{
+		for (int i = 0; i < input_count_; ++i)
+		{
+			const double x = _inputs[i];
+			if (x != x)
+			{
+				return -1;
+			}
+			const double* bounds_begin = interval_bounds_.data() + bound_offsets_[i];
+			const double* bounds_end = interval_bounds_.data() + bound_offsets_[i + 1];
+			const int interval = interval_offsets_[i] + static_cast<int>(std::upper_bound(bounds_begin, bounds_end, x) - bounds_begin);
+
+			// Input i's choices start after every earlier input's terms and untested marker.
+			int* choices = &active_choices_[input_offsets_[i] + i];
+			int count = 0;
+			for (int k = interval_term_offsets_[interval]; k < interval_term_offsets_[interval + 1]; ++k)
+			{
+				const int term = interval_terms_[k];
+				membership_[term] = ExactCentroid::Membership(input_terms_[term], x);
+				if (membership_[term] > 0.0)
+				{
+					choices[count++] = term - input_offsets_[i];
+				}
+			}
+			if (input_untested_[i])
+			{
+				choices[count++] = input_offsets_[i + 1] - input_offsets_[i];
+			}
+			if (count == 0)
+			{
+				return 0;
+			}
+			active_counts_[i] = count;
+			active_positions_[i] = 0;
+		}
+
+		// Every combination of one choice per input names a cell of rules that can fire.
+		// The rules of any other cell test at least one term that is zero here.
+		int rule_count = 0;
+		for (;;)
+		{
+			int cell = 0;
+			for (int i = 0; i < input_count_; ++i)
+			{
+				cell += active_choices_[input_offsets_[i] + i + active_positions_[i]] * cell_strides_[i];
+			}
+			for (int k = cell_offsets_[cell]; k < cell_offsets_[cell + 1]; ++k)
+			{
+				active_rules_[rule_count++] = cell_rules_[k];
+			}
+
+			int i = 0;
+			while (i < input_count_ && ++active_positions_[i] == active_counts_[i])
+			{
+				active_positions_[i] = 0;
+				++i;
+			}
+			if (i == input_count_)
+			{
+				return rule_count;
+			}
+		}
+	}
+
+	double FlatController::Evaluate(const double* _inputs, double* _degrees)
+	{
+		int candidates;
+		{
+			AGN_PROFILE_SCOPE("controller.fuzzify");
+			candidates = IsSparse() ? FuzzifySparse(_inputs) : -1;
+			if (candidates < 0)
+			{
+				Fuzzify(_inputs);
+			}
+		}
+		AGN_PROFILE_COUNT("controller.evaluations", 1);
+		AGN_PROFILE_COUNT("controller.rules", candidates >= 0 ? candidates : static_cast<int>(rule_outputs_.size()));
+
+		// Rule activation (Minimum conjunction) and accumulation of degrees per output term (Maximum)
+		{
+			AGN_PROFILE_SCOPE("controller.activate");
+			std::fill(activation_.begin(), activation_.end(), 0.0);
+			if (_degrees)
+			{
+				std::fill(_degrees, _degrees + rule_outputs_.size(), 0.0);
+			}
+			auto accumulate = [this, _degrees](int _rule)
+			{
+				const double degree = RuleDegree(_rule);
+				if (degree >= activation_threshold_)
+				{
+					activation_[rule_outputs_[_rule]] = std::max(activation_[rule_outputs_[_rule]], degree);
+					if (_degrees)
+					{
+						_degrees[_rule] = degree;
+					}
+				}
+			};
+			if (candidates >= 0)
+			{
+				for (int k = 0; k < candidates; ++k)
+				{
+					accumulate(active_rules_[k]);
+				}
+			}
+			else
+			{
+				const int rule_count = static_cast<int>(rule_outputs_.size());
+				for (int r = 0; r < rule_count; ++r)
+				{
+					accumulate(r);
+				}
+			}
+		}
+
+		// Aggregation (Minimum activation, Maximum accumulation) at the Centroid samples, if any.
+		// Only the samples and range covered by a fired term can be non-zero.
+		bool fired = false;
+		int sample_begin = resolution_;
+		int sample_end = 0;
+		double support_begin = output_maximum_;
+		double support_end = output_minimum_;
+		{
+			AGN_PROFILE_SCOPE("controller.accumulate");
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				if (activation_[t] > 0.0)
+				{
+					fired = true;
+					sample_begin = std::min(sample_begin, sample_begin_[t]);
+					sample_end = std::max(sample_end, sample_end_[t]);
+					support_begin = std::min(support_begin, output_support_[2 * t]);
+					support_end = std::max(support_end, output_support_[2 * t + 1]);
+				}
+			}
+			if (sample_begin < sample_end)
+			{
+				std::fill(aggregated_.begin() + sample_begin, aggregated_.begin() + sample_end, 0.0);
+			}
+			for (int t = 0; t < output_term_count_; ++t)
+			{
+				const double degree = activation_[t];
+				if (degree <= 0.0)
+				{
+					continue;
+				}
+				const double* membership = &output_membership_[t * resolution_];
+				for (int s = sample_begin_[t]; s < sample_end_[t]; ++s)
+				{
+					aggregated_[s] = std::max(aggregated_[s], std::min(membership[s], degree));
+				}
+			}
+		}
+
+		// Defuzzification
+		AGN_PROFILE_SCOPE("controller.defuzzify");
+		double result;
+		if (fired && exact_)
+		{
+			result = ExactCentroid::Integrate(output_terms_.data(), activation_.data(), output_term_count_,
+											  std::max(output_minimum_, support_begin), std::min(output_maximum_, support_end), workspace_);
+		}
+		else if (fired)
+		{
+			double area = 0.0;
+			double moment = 0.0;
+			for (int s = sample_begin; s < sample_end; ++s)
+			{
+				moment += aggregated_[s] * sample_x_[s];
+				area += aggregated_[s];
+			}
+			result = moment / area;
+		}
+		else
+		{
+			result = lock_previous_ && !fl::Op::isNaN(previous_value_) ? previous_value_ : default_value_;
+		}
+
+		if (lock_range_)
+		{
+			result = std::max(std::min(result, output_maximum_), output_minimum_);
+		}
+		if (fired)
+		{
+			previous_value_ = result;
+		}
+		return result;
+	}
+
+	void FlatController::Activate(const double* _inputs, double* _degrees)
+	{
+		const int rule_count = static_cast<int>(rule_outputs_.size());
+		const int candidates = IsSparse() ? FuzzifySparse(_inputs) : -1;
+		if (candidates >= 0)
+		{
+			std::fill(_degrees, _degrees + rule_count, 0.0);
+			for (int k = 0; k < candidates; ++k)
+			{
+				const double degree = RuleDegree(active_rules_[k]);
+				_degrees[active_rules_[k]] = degree >= activation_threshold_ ? degree : 0.0;
+			}
+			return;
+		}
+
+		Fuzzify(_inputs);
+		for (int r = 0; r < rule_count; ++r)
+		{
+			const double degree = RuleDegree(r);
+			_degrees[r] = degree >= activation_threshold_ ? degree : 0.0;
+		}
+	}
+
+	double FlatController::Steering(double _displacement, double _velocity)
+	{
+		assert(input_count_ == 2);
+		const double inputs[2] = { _displacement, _velocity };
+		return Evaluate(inputs);
+	}
+
+	FlatController* FlatController::Clone() const
+	{
+		return new FlatController(*this);
+	}
+}
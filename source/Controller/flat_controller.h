@@ -0,0 +1,193 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fl/Headers.h>
+#include "exact_centroid.h"
+#include "steering_controller.h"
+
+namespace car
+{
+	// FlatController
+	// Allocation free evaluator compiled from an fl::Engine. Terms become trapezoids in a flat
+	// array, rules become a table of term indices and the Centroid integrand is pretabulated
+	// for every output term, so evaluation is plain loops over doubles with no virtual calls,
+	// string handling or heap traffic.
+	//
+	// Supported engines: any number of input variables with Ramp, Triangle or Trapezoid terms,
+	// one output variable of the same term types, rules that are a conjunction of unhedged
+	// propositions with a single conclusion, Minimum conjunction and activation, Maximum
+	// accumulation and a Centroid or ExactCentroid defuzzifier.
+	//
+	// Sparse inference: with overlapping partitions only a couple of terms per input are non-zero
+	// at any point, so only a handful of rules can fire. Compile() indexes each input's term
+	// supports by the elementary intervals between their ends, and the rules by the term they test
+	// on each input. Evaluate() looks up the few candidate terms per input, then only visits the
+	// rules whose every tested term is non-zero, and the Centroid only integrates over the samples
+	// the fired output terms cover. Results are identical to evaluating every rule; the saving
+	// grows with the rule count (7x7, 9x9, three inputs) while the work per call stays roughly flat.
+	//
+	// Tolerance: a Centroid is integrated at the same midpoints as fl::Centroid and an
+	// ExactCentroid with the same closed form, so results match fl::Engine::process() to
+	// rounding error away from term breakpoints. Within
+	// fuzzylite's macheps (1e-5) of a breakpoint, fuzzylite's tolerant comparisons can differ
+	// from the exact membership; steering still agrees to within kTolerance.
+	class FlatController : public SteeringController
+	{
+	public:
+
+		static const double kTolerance;
+
+		FlatController();
+
+		// Compile
+		// Flattens _engine into this controller. The engine is only read, never processed.
+		// IN:		Engine to compile, optional string receiving the reasons compilation failed
+		// OUT:		False if the engine uses anything outside the supported subset
+		bool Compile(const fl::Engine& _engine, std::string* _status = nullptr);
+
+		// Save
+		// Writes the compiled terms, rule matrix, variable names and output settings to a binary cache in native
+		// byte order, tagged with _key (e.g. a hash of the source the engine was read from, see
+		// LoadCompiled()). Norms are implied: every compiled engine uses Minimum conjunction and
+		// activation and Maximum accumulation. Sample tables and indices are rebuilt on Load().
+		bool Save(const std::string& _file_name, std::uint64_t _key) const;
+
+		// Load
+		// Reads a cache written by Save(). Leaves this controller unchanged on failure, including
+		// when the cache has a different key or format version.
+		bool Load(const std::string& _file_name, std::uint64_t _key);
+
+		// Evaluate
+		// IN:		One value per input variable, in engine order
+		// OUT:		Defuzzified output value
+		inline double Evaluate(const double* _inputs) { return Evaluate(_inputs, nullptr); }
+
+		// Evaluate
+		// As above, also filling _degrees as Activate() would from the same inference pass.
+		// IN:		One value per input variable, array of GetRuleCount() degrees to fill or null
+		double Evaluate(const double* _inputs, double* _degrees);
+
+		// Activate
+		// Rule activation degrees (conjunction times weight) as fl::RuleBlock computes them,
+		// without defuzzifying. Rules below fuzzylite's activation threshold report zero.
+		// IN:		One value per input variable, array of GetRuleCount() degrees to fill
+		void Activate(const double* _inputs, double* _degrees);
+
+		// Steering
+		// Requires an engine compiled with exactly two inputs (displacement, velocity).
+		double Steering(double _displacement, double _velocity) override;
+		FlatController* Clone() const override;
+
+		inline int GetInputCount() const { return input_count_; }
+		inline int GetRuleCount() const { return static_cast<int>(rule_outputs_.size()); }
+		inline const std::string& GetRuleText(int _rule) const { return rule_text_[_rule]; }
+		inline const std::string& GetInputName(int _input) const { return variable_names_[_input]; }
+		inline const std::string& GetOutputName() const { return variable_names_[input_count_]; }
+
+		// Sparse inference is on by default. Engines whose rule index would exceed kMaxRuleCells
+		// always evaluate every rule.
+		static const int kMaxRuleCells;
+		inline void SetSparse(bool _sparse) { sparse_ = _sparse; }
+		inline bool IsSparse() const { return sparse_ && !cell_offsets_.empty(); }
+
+	private:
+
+		// BatchController evaluates the same compiled tables many cars at a time.
+		friend class BatchController;
+
+		typedef ExactCentroid::Trapezoid Trapezoid;
+
+		// Prepare
+		// Derives the Centroid samples, scratch space and indices from the compiled tables.
+		void Prepare();
+		void Fuzzify(const double* _inputs);
+		// BuildIndex
+		// Builds the interval and rule indices from the compiled terms and rules.
+		void BuildIndex();
+		// FuzzifySparse
+		// Fuzzifies only the terms that can be non-zero and collects the rules they allow to fire
+		// into active_rules_.
+		// OUT:		Number of candidate rules, or -1 if an input is NaN and the dense path must be used
+		int FuzzifySparse(const double* _inputs);
+		inline double RuleDegree(int _rule) const
+		{
+			const int* terms = &rule_terms_[_rule * input_count_];
+			double degree = 1.0;
+			for (int i = 0; i < input_count_; ++i)
+			{
+				if (terms[i] >= 0)
+				{
+					degree = std::min(degree, membership_[terms[i]]);
+				}
+			}
+			return degree * rule_weights_[_rule];
+		}
+
+		int input_count_;
+		// Input terms for input i are input_terms_[input_offsets_[i], input_offsets_[i + 1]).
+		std::vector<Trapezoid> input_terms_;
+		std::vector<int> input_offsets_;
+
+		// Rule r tests input term rule_terms_[r * input_count_ + i], or nothing if -1.
+		std::vector<int> rule_terms_;
+		std::vector<int> rule_outputs_;
+		std::vector<double> rule_weights_;
+		std::vector<std::string> rule_text_;
+		// Input variable names in engine order, then the output variable's.
+		std::vector<std::string> variable_names_;
+		double activation_threshold_;
+
+		// Interval index. Input i's term ends are the sorted bounds
+		// interval_bounds_[bound_offsets_[i], bound_offsets_[i + 1]); with n bounds it has n + 1
+		// elementary intervals, numbered from interval_offsets_[i]. Interval k lists the terms whose
+		// closed support meets it in interval_terms_[interval_term_offsets_[k], interval_term_offsets_[k + 1]).
+		std::vector<double> interval_bounds_;
+		std::vector<int> bound_offsets_;
+		std::vector<int> interval_offsets_;
+		std::vector<int> interval_term_offsets_;
+		std::vector<int> interval_terms_;
+
+		// Rule index. A rule's cell is the sum over inputs of its local term times cell_strides_[i],
+		// with the input's term count standing for "not tested". Cell c holds the rules
+		// cell_rules_[cell_offsets_[c], cell_offsets_[c + 1]). Empty if the engine has too many cells.
+		std::vector<int> cell_strides_;
+		std::vector<int> cell_offsets_;
+		std::vector<int> cell_rules_;
+		// Whether any rule leaves input i untested.
+		std::vector<char> input_untested_;
+		bool sparse_;
+
+		// Membership of output term t at Centroid sample s is output_membership_[t * resolution_ + s].
+		// An ExactCentroid integrates output_terms_ in closed form instead and has no samples.
+		int output_term_count_;
+		bool exact_;
+		std::vector<Trapezoid> output_terms_;
+		int resolution_;
+		std::vector<double> sample_x_;
+		std::vector<double> output_membership_;
+		// Centroid samples [sample_begin_[t], sample_end_[t]) are the only ones output term t is
+		// non-zero at. An ExactCentroid only integrates between output_support_[2t] and [2t + 1].
+		std::vector<int> sample_begin_;
+		std::vector<int> sample_end_;
+		std::vector<double> output_support_;
+
+		double output_minimum_, output_maximum_;
+		double default_value_;
+		double previous_value_;
+		bool lock_range_;
+		bool lock_previous_;
+
+		// Scratch space sized by Compile() so Evaluate() never allocates.
+		std::vector<double> membership_;
+		std::vector<double> activation_;
+		std::vector<double> aggregated_;
+		// Per input, the local terms (or the untested marker) that are non-zero, and how many.
+		std::vector<int> active_choices_;
+		std::vector<int> active_counts_;
+		std::vector<int> active_rules_;
+		std::vector<int> active_positions_;
+		ExactCentroid::Workspace workspace_;
+	};
+}
@@ -0,0 +1,32 @@
+#include "steering_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace car
+{
+	ControllerError CompareControllers(SteeringController& _candidate, SteeringController& _reference, int _samples,
+									   double _displacement_min, double _displacement_max,
+									   double _velocity_min, double _velocity_max)
+	{
+		ControllerError error = { 0.0, 0.0 };
+		if (_samples < 2)
+		{
+			return error;
+		}
+
+		double total = 0.0;
+		for (int i = 0; i < _samples; ++i)
+		{
+			const double displacement = _displacement_min + (_displacement_max - _displacement_min) * i / (_samples - 1);
+			for (int j = 0; j < _samples; ++j)
+			{
+				const double velocity = _velocity_min + (_velocity_max - _velocity_min) * j / (_samples - 1);
+				const double difference = std::abs(_candidate.Steering(displacement, velocity) - _reference.Steering(displacement, velocity));
+				error.maximum = std::max(error.maximum, difference);
+				total += difference;
+			}
+		}
+		error.mean = total / (static_cast<double>(_samples) * _samples);
+		return error;
+	}
+}
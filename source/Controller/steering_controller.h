@@ -0,0 +1,39 @@
+#pragma once
+
+namespace car
+{
+	// SteeringController
+	// Maps the car's current displacement and velocity to a steering output.
+	// Implementations may hold mutable evaluation state, so one instance must only
+	// be used by one thread at a time. Use Clone() to give each worker its own copy.
+	class SteeringController
+	{
+	public:
+
+		virtual ~SteeringController() {}
+
+		// Steering
+		// IN:		Displacement and velocity, both nominally in [-1, 1]
+		// OUT:		Steering output in [-1, 1]
+		virtual double Steering(double _displacement, double _velocity) = 0;
+
+		// Clone
+		// OUT:		Independent copy of this controller, owned by the caller
+		virtual SteeringController* Clone() const = 0;
+	};
+
+	struct ControllerError
+	{
+		double maximum;
+		double mean;
+	};
+
+	// CompareControllers
+	// Evaluates both controllers on a regular _samples x _samples grid (edges included)
+	// and reports the absolute difference in steering.
+	// IN:		Controller under test, reference controller, samples per axis (at least 2), input ranges
+	// OUT:		Maximum and mean absolute steering error
+	ControllerError CompareControllers(SteeringController& _candidate, SteeringController& _reference, int _samples,
+									   double _displacement_min = -1.0, double _displacement_max = 1.0,
+									   double _velocity_min = -1.0, double _velocity_max = 1.0);
+}
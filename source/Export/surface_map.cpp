@@ -0,0 +1,394 @@
+#include "surface_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <Agnostic/profiler.h>
+#include <Agnostic/work_stealing_pool.h>
+#include "../Controller/flat_controller.h"
+
+namespace car
+{
+	namespace
+	{
+		const char kMagic[4] = { 'F', 'C', 'S', 'M' };
+		const std::uint32_t kVersion = 2;
+
+		// Two inputs and the output.
+		const std::size_t kVariableCount = 3;
+
+		// Rows formatted per task when writing CSV, and tasks formatted before each write.
+		const int kCsvRows = 16;
+		const int kCsvTasksPerThread = 4;
+
+		struct FileHeader
+		{
+			char magic[4];
+			std::uint32_t version;
+			std::int32_t displacement_count;
+			std::int32_t velocity_count;
+			std::int32_t rule_count;
+			std::int32_t has_rule_maps;
+			double displacement_min, displacement_max;
+			double velocity_min, velocity_max;
+		};
+
+		// Fixed point formatting as "%.*f" would print it, except that values which round to zero
+		// print unsigned as fuzzylite does, never as "-0.000". Values that fit in 64 bits once scaled
+		// are rounded and printed as integers, which is many times faster than snprintf. Output only
+		// differs where scaling rounds a value onto or off a tie.
+		void AppendNumber(std::string& _text, double _value, int _decimals)
+		{
+			static const double kPowers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+			const double scaled = std::abs(_value) * (_decimals < 10 ? kPowers[_decimals] : 0.0);
+			if (_decimals >= 10 || !(scaled < 1e18))
+			{
+				char buffer[512];
+				const int length = std::snprintf(buffer, sizeof(buffer), "%.*f", _decimals, _value);
+				const std::size_t size = static_cast<std::size_t>(std::min(std::max(length, 0), static_cast<int>(sizeof(buffer)) - 1));
+				const std::size_t sign = buffer[0] == '-' && std::strspn(buffer + 1, "0.") == size - 1 ? 1 : 0;
+				_text.append(buffer + sign, size - sign);
+				return;
+			}
+
+			// Ties round to even like printf.
+			std::uint64_t digits = static_cast<std::uint64_t>(scaled);
+			const double fraction = scaled - static_cast<double>(digits);
+			if (fraction > 0.5 || (fraction == 0.5 && (digits & 1)))
+			{
+				++digits;
+			}
+			const bool negative = std::signbit(_value) && digits > 0;
+			char buffer[32];
+			char* end = buffer + sizeof(buffer);
+			char* write = end;
+			for (int d = 0; d < _decimals; ++d)
+			{
+				*--write = static_cast<char>('0' + digits % 10);
+				digits /= 10;
+			}
+			if (_decimals > 0)
+			{
+				*--write = '.';
+			}
+			do
+			{
+				*--write = static_cast<char>('0' + digits % 10);
+				digits /= 10;
+			} while (digits);
+			if (negative)
+			{
+				*--write = '-';
+			}
+			_text.append(write, static_cast<std::size_t>(end - write));
+		}
+
+		template <typename T>
+		bool ReadVector(std::ifstream& _file, std::vector<T>& _values, std::size_t _count)
+		{
+			_values.resize(_count);
+			return _count == 0 || static_cast<bool>(_file.read(reinterpret_cast<char*>(_values.data()), _count * sizeof(T)));
+		}
+
+		// Strings are stored as a uint32 length followed by the characters.
+		void WriteStrings(std::ofstream& _file, const std::vector<std::string>& _strings)
+		{
+			for (const std::string& text : _strings)
+			{
+				const std::uint32_t length = static_cast<std::uint32_t>(text.size());
+				_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+				_file.write(text.data(), length);
+			}
+		}
+
+		bool ReadStrings(std::ifstream& _file, std::vector<std::string>& _strings, std::size_t _count)
+		{
+			_strings.resize(_count);
+			for (std::string& text : _strings)
+			{
+				std::uint32_t length;
+				if (!_file.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > (1u << 20))
+				{
+					return false;
+				}
+				text.resize(length);
+				if (length > 0 && !_file.read(&text[0], length))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	SurfaceMap::SurfaceMap()
+	{}
+
+	bool SurfaceMap::Build(const fl::Engine& _engine, const SurfaceMapSettings& _settings, std::string* _status)
+	{
+		FlatController compiled;
+		return compiled.Compile(_engine, _status) && Build(compiled, _settings, _status);
+	}
+
+	bool SurfaceMap::Build(const FlatController& _compiled, const SurfaceMapSettings& _settings, std::string* _status)
+	{
+		if (_settings.displacement_count < 2 || _settings.velocity_count < 2 ||
+			!(_settings.displacement_max > _settings.displacement_min) ||
+			!(_settings.velocity_max > _settings.velocity_min))
+		{
+			if (_status)
+			{
+				_status->append("- Each axis needs at least two points and a non-empty range.\n");
+			}
+			return false;
+		}
+
+		if (_compiled.GetInputCount() != 2)
+		{
+			if (_status)
+			{
+				_status->append("- Engine must have exactly two input variables.\n");
+			}
+			return false;
+		}
+		const int rule_count = _compiled.GetRuleCount();
+		if (rule_count > 0x7FFF)
+		{
+			if (_status)
+			{
+				_status->append("- Engine has too many rules to map.\n");
+			}
+			return false;
+		}
+
+		AGN_PROFILE_SCOPE("export.surface");
+		settings_ = _settings;
+		variable_names_.assign({ _compiled.GetInputName(0), _compiled.GetInputName(1), _compiled.GetOutputName() });
+		rule_text_.clear();
+		for (int r = 0; r < rule_count; ++r)
+		{
+			rule_text_.push_back(_compiled.GetRuleText(r));
+		}
+		const std::size_t size = Size();
+		steering_.assign(size, 0.0);
+		dominant_rule_.assign(size, -1);
+		activation_.assign(settings_.rule_maps ? size * rule_count : 0, 0.0f);
+
+		agn::WorkStealingPool pool(settings_.threads);
+		std::vector<std::unique_ptr<FlatController>> controllers;
+		for (unsigned i = 0; i < pool.GetThreadCount(); ++i)
+		{
+			controllers.emplace_back(_compiled.Clone());
+		}
+
+		for (int d = 0; d < settings_.displacement_count; ++d)
+		{
+			pool.Submit([this, d, rule_count, size, &controllers](unsigned _worker)
+			{
+				AGN_PROFILE_SCOPE("export.row");
+				FlatController& controller = *controllers[_worker];
+				std::vector<double> degrees(rule_count);
+				double inputs[2] = { GetDisplacement(d), 0.0 };
+				for (int v = 0; v < settings_.velocity_count; ++v)
+				{
+					inputs[1] = GetVelocity(v);
+					const std::size_t index = Index(d, v);
+					// One inference pass gives both the output and every rule's degree.
+					steering_[index] = controller.Evaluate(inputs, degrees.data());
+					int dominant = -1;
+					double strongest = 0.0;
+					for (int r = 0; r < rule_count; ++r)
+					{
+						if (degrees[r] > strongest)
+						{
+							strongest = degrees[r];
+							dominant = r;
+						}
+						if (settings_.rule_maps)
+						{
+							activation_[r * size + index] = static_cast<float>(degrees[r]);
+						}
+					}
+					dominant_rule_[index] = static_cast<std::int16_t>(dominant);
+				}
+			});
+		}
+		pool.Wait();
+		return true;
+	}
+
+	bool SurfaceMap::Save(const std::string& _file_name) const
+	{
+		if (steering_.empty())
+		{
+			return false;
+		}
+
+		std::ofstream file(_file_name, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.displacement_count = settings_.displacement_count;
+		header.velocity_count = settings_.velocity_count;
+		header.rule_count = GetRuleCount();
+		header.has_rule_maps = settings_.rule_maps ? 1 : 0;
+		header.displacement_min = settings_.displacement_min;
+		header.displacement_max = settings_.displacement_max;
+		header.velocity_min = settings_.velocity_min;
+		header.velocity_max = settings_.velocity_max;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteStrings(file, variable_names_);
+		WriteStrings(file, rule_text_);
+
+		file.write(reinterpret_cast<const char*>(steering_.data()), steering_.size() * sizeof(double));
+		file.write(reinterpret_cast<const char*>(dominant_rule_.data()), dominant_rule_.size() * sizeof(std::int16_t));
+		if (!activation_.empty())
+		{
+			file.write(reinterpret_cast<const char*>(activation_.data()), activation_.size() * sizeof(float));
+		}
+		return static_cast<bool>(file);
+	}
+
+	bool SurfaceMap::Load(const std::string& _file_name)
+	{
+		std::ifstream file(_file_name, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+			header.version != kVersion ||
+			header.displacement_count < 2 || header.velocity_count < 2 ||
+			header.rule_count < 0 || header.rule_count > 0x7FFF ||
+			!(header.displacement_max > header.displacement_min) ||
+			!(header.velocity_max > header.velocity_min))
+		{
+			return false;
+		}
+
+		std::vector<std::string> variable_names, rule_text;
+		if (!ReadStrings(file, variable_names, kVariableCount) ||
+			!ReadStrings(file, rule_text, header.rule_count))
+		{
+			return false;
+		}
+
+		const std::size_t size = static_cast<std::size_t>(header.displacement_count) * header.velocity_count;
+		std::vector<double> steering;
+		std::vector<std::int16_t> dominant_rule;
+		std::vector<float> activation;
+		if (!ReadVector(file, steering, size) ||
+			!ReadVector(file, dominant_rule, size) ||
+			!ReadVector(file, activation, header.has_rule_maps ? size * header.rule_count : 0))
+		{
+			return false;
+		}
+
+		settings_.displacement_count = header.displacement_count;
+		settings_.velocity_count = header.velocity_count;
+		settings_.displacement_min = header.displacement_min;
+		settings_.displacement_max = header.displacement_max;
+		settings_.velocity_min = header.velocity_min;
+		settings_.velocity_max = header.velocity_max;
+		settings_.rule_maps = header.has_rule_maps != 0;
+		variable_names_.swap(variable_names);
+		rule_text_.swap(rule_text);
+		steering_.swap(steering);
+		dominant_rule_.swap(dominant_rule);
+		activation_.swap(activation);
+		return true;
+	}
+
+	bool SurfaceMap::SaveCsv(const std::string& _file_name, int _decimals) const
+	{
+		if (steering_.empty())
+		{
+			return false;
+		}
+
+		std::ofstream file(_file_name, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		file << variable_names_[0] << ',' << variable_names_[1] << ',' << variable_names_[2];
+		if (settings_.rule_maps)
+		{
+			for (const std::string& text : rule_text_)
+			{
+				file << ",\"" << text << '"';
+			}
+		}
+		file << '\n';
+
+		// Blocks of rows are formatted in parallel, then written in order.
+		agn::WorkStealingPool pool(settings_.threads);
+		const int tasks = static_cast<int>(pool.GetThreadCount()) * kCsvTasksPerThread;
+		std::vector<std::string> text(tasks);
+		const int rule_count = settings_.rule_maps ? GetRuleCount() : 0;
+		for (int first = 0; first < settings_.displacement_count && file; first += tasks * kCsvRows)
+		{
+			for (int t = 0; t < tasks; ++t)
+			{
+				const int begin = first + t * kCsvRows;
+				const int end = std::min(begin + kCsvRows, settings_.displacement_count);
+				pool.Submit([this, begin, end, t, rule_count, _decimals, &text](unsigned)
+				{
+					std::string& rows = text[t];
+					rows.clear();
+					for (int d = begin; d < end; ++d)
+					{
+						for (int v = 0; v < settings_.velocity_count; ++v)
+						{
+							AppendNumber(rows, GetDisplacement(d), _decimals);
+							rows.push_back(',');
+							AppendNumber(rows, GetVelocity(v), _decimals);
+							rows.push_back(',');
+							AppendNumber(rows, GetSteering(d, v), _decimals);
+							for (int r = 0; r < rule_count; ++r)
+							{
+								rows.push_back(',');
+								AppendNumber(rows, GetActivation(r, d, v), _decimals);
+							}
+							rows.push_back('\n');
+						}
+					}
+				});
+			}
+			pool.Wait();
+			for (const std::string& rows : text)
+			{
+				file.write(rows.data(), rows.size());
+			}
+		}
+		return static_cast<bool>(file);
+	}
+
+	std::vector<double> SurfaceMap::DominanceShares() const
+	{
+		std::vector<double> shares(rule_text_.size(), 0.0);
+		for (const std::int16_t rule : dominant_rule_)
+		{
+			if (rule >= 0)
+			{
+				shares[rule] += 1.0;
+			}
+		}
+		for (double& share : shares)
+		{
+			share /= static_cast<double>(dominant_rule_.size());
+		}
+		return shares;
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fl/Headers.h>
+#include "../Controller/flat_controller.h"
+
+namespace car
+{
+	struct SurfaceMapSettings
+	{
+		// Points per axis. Each axis runs inclusively from min to max.
+		int displacement_count = 257;
+		int velocity_count = 257;
+		double displacement_min = -1.0, displacement_max = 1.0;
+		double velocity_min = -1.0, velocity_max = 1.0;
+		// Also record every rule's activation degree at every point.
+		bool rule_maps = true;
+		// Worker threads. Zero uses std::thread::hardware_concurrency().
+		unsigned threads = 0;
+	};
+
+	// SurfaceMap
+	// Steering output of a two input engine over a regular grid, with the activation degree of
+	// every rule and the most active rule at each point. Rows are evaluated in parallel by the
+	// flattened kernel (one FlatController per worker), replacing fl::FldExporter's serial
+	// engine->process() and string formatting per value.
+	//
+	// Binary layout (native byte order), see Save():
+	//		FileHeader
+	//		3 * (uint32 length, variable name)			displacement input, velocity input, output
+	//		rule_count * (uint32 length, rule text)
+	//		double steering[displacement_count][velocity_count]
+	//		int16 dominant_rule[displacement_count][velocity_count]		-1 where no rule fires
+	//		float activation[rule_count][displacement_count][velocity_count]	if has_rule_maps
+	class SurfaceMap
+	{
+	public:
+
+		SurfaceMap();
+
+		// Build
+		// IN:		Engine to compile and sample, grid settings, optional string receiving errors
+		// OUT:		False if the settings are invalid or the engine cannot be flattened
+		bool Build(const fl::Engine& _engine, const SurfaceMapSettings& _settings, std::string* _status = nullptr);
+
+		// Build
+		// As above for an engine already compiled, e.g. loaded from a controller cache.
+		bool Build(const FlatController& _compiled, const SurfaceMapSettings& _settings, std::string* _status = nullptr);
+
+		// Save
+		// Writes the binary layout above.
+		bool Save(const std::string& _file_name) const;
+
+		// Load
+		// Reads a map written by Save(). Leaves this map unchanged on failure.
+		bool Load(const std::string& _file_name);
+
+		// SaveCsv
+		// Writes a row per grid point with the values fl::FldExporter exports with a "," separator
+		// (both inputs, then the output, headed by the engine's variable names), followed by one
+		// column per rule if the map has rule maps. Rows are formatted in parallel.
+		// IN:		File name, decimal places (fuzzylite's default is fl::fuzzylite::decimals())
+		bool SaveCsv(const std::string& _file_name, int _decimals) const;
+
+		inline int GetDisplacementCount() const { return settings_.displacement_count; }
+		inline int GetVelocityCount() const { return settings_.velocity_count; }
+		inline int GetRuleCount() const { return static_cast<int>(rule_text_.size()); }
+		inline bool HasRuleMaps() const { return settings_.rule_maps; }
+		inline const std::string& GetRuleText(int _rule) const { return rule_text_[_rule]; }
+		// Names of the displacement input (0), the velocity input (1) and the output (2).
+		inline const std::string& GetVariableName(int _variable) const { return variable_names_[_variable]; }
+
+		inline double GetDisplacement(int _d) const { return Axis(settings_.displacement_min, settings_.displacement_max, settings_.displacement_count, _d); }
+		inline double GetVelocity(int _v) const { return Axis(settings_.velocity_min, settings_.velocity_max, settings_.velocity_count, _v); }
+		inline double GetSteering(int _d, int _v) const { return steering_[Index(_d, _v)]; }
+		inline int GetDominantRule(int _d, int _v) const { return dominant_rule_[Index(_d, _v)]; }
+		inline float GetActivation(int _rule, int _d, int _v) const { return activation_[_rule * Size() + Index(_d, _v)]; }
+
+		// Share of the grid on which each rule is the most active one.
+		std::vector<double> DominanceShares() const;
+
+	private:
+
+		static inline double Axis(double _min, double _max, int _count, int _index)
+		{
+			return _min + (_max - _min) * _index / (_count - 1);
+		}
+		inline std::size_t Size() const { return static_cast<std::size_t>(settings_.displacement_count) * settings_.velocity_count; }
+		inline std::size_t Index(int _d, int _v) const { return static_cast<std::size_t>(_d) * settings_.velocity_count + _v; }
+
+		SurfaceMapSettings settings_;
+		std::vector<std::string> variable_names_;
+		std::vector<std::string> rule_text_;
+		std::vector<double> steering_;
+		std::vector<std::int16_t> dominant_rule_;
+		std::vector<float> activation_;
+	};
+}
@@ -0,0 +1,135 @@
+#include "trajectory_format.h"
+#include <cstring>
+
+namespace car
+{
+	namespace trajectory_format
+	{
+		const char kMagic[4] = { 'F', 'C', 'T', 'R' };
+		const std::uint32_t kVersion = 1;
+
+		namespace
+		{
+			const int kFields = 4;
+
+			inline void Fields(const TrajectoryRecord& _record, double* _fields)
+			{
+				_fields[0] = _record.time;
+				_fields[1] = _record.state.displacement;
+				_fields[2] = _record.state.velocity;
+				_fields[3] = _record.state.steering;
+			}
+
+			inline std::uint64_t Bits(double _value)
+			{
+				std::uint64_t bits;
+				std::memcpy(&bits, &_value, sizeof(bits));
+				return bits;
+			}
+
+			inline double Value(std::uint64_t _bits)
+			{
+				double value;
+				std::memcpy(&value, &_bits, sizeof(value));
+				return value;
+			}
+
+			// Linear extrapolation from the last two values of a field. Doubling is exact, so the
+			// encoder and decoder agree bit for bit however the expression is compiled.
+			inline double Predict(std::size_t _index, double _last, double _before_last)
+			{
+				return _index == 0 ? 0.0 : _index == 1 ? _last : 2.0 * _last - _before_last;
+			}
+
+			inline int SignificantBytes(std::uint64_t _bits)
+			{
+				int bytes = 0;
+				while (_bits)
+				{
+					++bytes;
+					_bits >>= 8;
+				}
+				return bytes;
+			}
+		}
+
+		void Encode(const TrajectoryRecord* _records, std::size_t _count, std::vector<unsigned char>& _payload)
+		{
+			double last[kFields] = {};
+			double before_last[kFields] = {};
+			for (std::size_t i = 0; i < _count; ++i)
+			{
+				double fields[kFields];
+				Fields(_records[i], fields);
+
+				std::uint64_t errors[kFields];
+				int bytes[kFields];
+				for (int f = 0; f < kFields; ++f)
+				{
+					errors[f] = Bits(fields[f]) ^ Bits(Predict(i, last[f], before_last[f]));
+					bytes[f] = SignificantBytes(errors[f]);
+					before_last[f] = last[f];
+					last[f] = fields[f];
+				}
+
+				// Two byte counts per header byte, then the low bytes of each error.
+				for (int f = 0; f < kFields; f += 2)
+				{
+					_payload.push_back(static_cast<unsigned char>(bytes[f] | (bytes[f + 1] << 4)));
+				}
+				for (int f = 0; f < kFields; ++f)
+				{
+					for (int b = 0; b < bytes[f]; ++b)
+					{
+						_payload.push_back(static_cast<unsigned char>(errors[f] >> (8 * b)));
+					}
+				}
+			}
+		}
+
+		bool Decode(const unsigned char* _payload, std::size_t _size, std::size_t _count, TrajectoryRecord* _records)
+		{
+			const unsigned char* read = _payload;
+			const unsigned char* const end = _payload + _size;
+			double last[kFields] = {};
+			double before_last[kFields] = {};
+			for (std::size_t i = 0; i < _count; ++i)
+			{
+				if (end - read < kFields / 2)
+				{
+					return false;
+				}
+				int bytes[kFields];
+				for (int f = 0; f < kFields; f += 2)
+				{
+					bytes[f] = *read & 0x0F;
+					bytes[f + 1] = *read >> 4;
+					++read;
+				}
+
+				double fields[kFields];
+				for (int f = 0; f < kFields; ++f)
+				{
+					if (bytes[f] > 8 || end - read < bytes[f])
+					{
+						return false;
+					}
+					std::uint64_t error = 0;
+					for (int b = 0; b < bytes[f]; ++b)
+					{
+						error |= static_cast<std::uint64_t>(*read++) << (8 * b);
+					}
+					fields[f] = Value(error ^ Bits(Predict(i, last[f], before_last[f])));
+					before_last[f] = last[f];
+					last[f] = fields[f];
+				}
+
+				_records[i].time = fields[0];
+				_records[i].state.displacement = fields[1];
+				_records[i].state.velocity = fields[2];
+				_records[i].state.steering = fields[3];
+			}
+			return read == end;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../Simulation/car_state.h"
+
+namespace car
+{
+	struct TrajectoryRecord
+	{
+		double time;
+		CarState state;
+	};
+
+	// Trajectory log layout, all integers and doubles in native byte order:
+	//		FileHeader
+	//		Chunk * n			ChunkHeader followed by its compressed records
+	//		ChunkIndexEntry * n	written by TrajectoryRecorder::Close()
+	//		FileTrailer
+	// Each chunk belongs to one run and decodes on its own, so a reader can seek to any chunk.
+	// A log without a trailer (the recorder was not closed) is still readable by walking the
+	// chunk headers from the start.
+	namespace trajectory_format
+	{
+		extern const char kMagic[4];
+		extern const std::uint32_t kVersion;
+
+		struct FileHeader
+		{
+			char magic[4];
+			std::uint32_t version;
+			std::uint32_t chunk_records;
+			std::uint32_t reserved;
+		};
+
+		struct ChunkHeader
+		{
+			std::uint32_t run;
+			std::uint32_t record_count;
+			std::uint32_t payload_size;
+			std::uint32_t reserved;
+			double first_time;
+			double last_time;
+		};
+
+		struct ChunkIndexEntry
+		{
+			std::uint64_t offset;
+			ChunkHeader header;
+		};
+
+		struct FileTrailer
+		{
+			std::uint64_t index_offset;
+			std::uint64_t chunk_count;
+			char magic[4];
+			std::uint32_t version;
+		};
+
+		// Encode
+		// Compresses records losslessly. Each field is predicted by linear extrapolation of its
+		// previous two values and only the significant bytes of the prediction error (the XOR of
+		// the bit patterns) are stored, behind a 4 bit byte count. Smooth trajectories sampled at
+		// the simulation rate mostly differ in their low mantissa bytes.
+		// IN:		Records, count, buffer to append the payload to
+		void Encode(const TrajectoryRecord* _records, std::size_t _count, std::vector<unsigned char>& _payload);
+
+		// Decode
+		// IN:		Payload written by Encode(), its size, the record count and output array
+		// OUT:		False if the payload is truncated or does not hold exactly _count records
+		bool Decode(const unsigned char* _payload, std::size_t _size, std::size_t _count, TrajectoryRecord* _records);
+	}
+}
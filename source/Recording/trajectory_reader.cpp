@@ -0,0 +1,320 @@
+#include "trajectory_reader.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace car
+{
+	using namespace trajectory_format;
+
+	namespace
+	{
+		const std::size_t kNoChunk = static_cast<std::size_t>(-1);
+	}
+
+	TrajectoryReader::TrajectoryReader() :
+		data_(nullptr),
+		size_(0),
+		file_handle_(nullptr),
+		mapping_handle_(nullptr),
+		cached_chunk_(kNoChunk)
+	{}
+
+	TrajectoryReader::~TrajectoryReader()
+	{
+		Close();
+	}
+
+	bool TrajectoryReader::Open(const std::string& _file_name)
+	{
+		Close();
+		if (!Map(_file_name))
+		{
+			return false;
+		}
+
+		FileHeader header;
+		if (size_ < sizeof(header))
+		{
+			Close();
+			return false;
+		}
+		std::memcpy(&header, data_, sizeof(header));
+		if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+		{
+			Close();
+			return false;
+		}
+
+		if (!ReadIndex())
+		{
+			chunks_.clear();
+			runs_.clear();
+			if (!ScanChunks())
+			{
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void TrajectoryReader::Close()
+	{
+		Unmap();
+		chunks_.clear();
+		runs_.clear();
+		cache_.clear();
+		cached_chunk_ = kNoChunk;
+	}
+
+	bool TrajectoryReader::Read(int _run, std::size_t _index, TrajectoryRecord& _record)
+	{
+		if (_run < 0 || _run >= GetRunCount() || _index >= runs_[_run].record_count)
+		{
+			return false;
+		}
+		const std::size_t chunk = ChunkOf(_run, _index);
+		if (!Decompress(chunk))
+		{
+			return false;
+		}
+		_record = cache_[_index - chunks_[chunk].first_record];
+		return true;
+	}
+
+	bool TrajectoryReader::ReadRun(int _run, std::vector<TrajectoryRecord>& _records)
+	{
+		if (_run < 0 || _run >= GetRunCount())
+		{
+			return false;
+		}
+		const Run& run = runs_[_run];
+		_records.resize(run.record_count);
+		for (std::size_t c = run.first_chunk; c < run.first_chunk + run.chunk_count; ++c)
+		{
+			const Chunk& chunk = chunks_[c];
+			if (!Decode(chunk.payload, chunk.header.payload_size, chunk.header.record_count, &_records[chunk.first_record]))
+			{
+				_records.clear();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::size_t TrajectoryReader::Find(int _run, double _time)
+	{
+		if (_run < 0 || _run >= GetRunCount())
+		{
+			return 0;
+		}
+		const Run& run = runs_[_run];
+		const auto first = chunks_.begin() + run.first_chunk;
+		const auto last = first + run.chunk_count;
+		auto chunk = std::upper_bound(first, last, _time,
+									  [](double _t, const Chunk& _chunk) { return _t < _chunk.header.first_time; });
+		if (chunk == first)
+		{
+			return 0;
+		}
+		--chunk;
+
+		const std::size_t c = static_cast<std::size_t>(chunk - chunks_.begin());
+		if (!Decompress(c))
+		{
+			return chunk->first_record;
+		}
+		const auto record = std::upper_bound(cache_.begin(), cache_.end(), _time,
+											 [](double _t, const TrajectoryRecord& _record) { return _t < _record.time; });
+		return chunk->first_record + static_cast<std::size_t>(record - cache_.begin()) - 1;
+	}
+
+	bool TrajectoryReader::Map(const std::string& _file_name)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(_file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+								  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		file_handle_ = file;
+		mapping_handle_ = mapping;
+		data_ = static_cast<const unsigned char*>(view);
+		size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+		const int file = open(_file_name.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size <= 0)
+		{
+			close(file);
+			return false;
+		}
+		void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		// The mapping keeps the file referenced.
+		close(file);
+		if (view == MAP_FAILED)
+		{
+			return false;
+		}
+		data_ = static_cast<const unsigned char*>(view);
+		size_ = static_cast<std::size_t>(status.st_size);
+#endif
+		return true;
+	}
+
+	void TrajectoryReader::Unmap()
+	{
+		if (!data_)
+		{
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+		CloseHandle(mapping_handle_);
+		CloseHandle(file_handle_);
+		mapping_handle_ = nullptr;
+		file_handle_ = nullptr;
+#else
+		munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	bool TrajectoryReader::ReadIndex()
+	{
+		FileTrailer trailer;
+		if (size_ < sizeof(FileHeader) + sizeof(trailer))
+		{
+			return false;
+		}
+		std::memcpy(&trailer, data_ + size_ - sizeof(trailer), sizeof(trailer));
+		const std::uint64_t index_end = size_ - sizeof(trailer);
+		if (std::memcmp(trailer.magic, kMagic, sizeof(kMagic)) != 0 || trailer.version != kVersion ||
+			trailer.index_offset < sizeof(FileHeader) || trailer.index_offset > index_end ||
+			trailer.chunk_count != (index_end - trailer.index_offset) / sizeof(ChunkIndexEntry) ||
+			(index_end - trailer.index_offset) % sizeof(ChunkIndexEntry) != 0)
+		{
+			return false;
+		}
+
+		for (std::uint64_t i = 0; i < trailer.chunk_count; ++i)
+		{
+			ChunkIndexEntry entry;
+			std::memcpy(&entry, data_ + trailer.index_offset + i * sizeof(entry), sizeof(entry));
+			if (entry.offset + sizeof(ChunkHeader) + entry.header.payload_size > trailer.index_offset ||
+				!AddChunk(entry.header, entry.offset))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool TrajectoryReader::ScanChunks()
+	{
+		// Stops at the first chunk that is cut short, which is where an unclosed recorder stopped.
+		std::uint64_t offset = sizeof(FileHeader);
+		while (offset + sizeof(ChunkHeader) <= size_)
+		{
+			ChunkHeader header;
+			std::memcpy(&header, data_ + offset, sizeof(header));
+			if (offset + sizeof(header) + header.payload_size > size_ || !AddChunk(header, offset))
+			{
+				break;
+			}
+			offset += sizeof(header) + header.payload_size;
+		}
+		return true;
+	}
+
+	bool TrajectoryReader::AddChunk(const ChunkHeader& _header, std::uint64_t _offset)
+	{
+		// Runs are written in order and each chunk holds at least two header bytes per record.
+		if (_header.record_count == 0 || _header.payload_size < _header.record_count * 2ull ||
+			(!chunks_.empty() && _header.run < chunks_.back().header.run))
+		{
+			return false;
+		}
+
+		Chunk chunk;
+		chunk.header = _header;
+		chunk.payload = data_ + _offset + sizeof(ChunkHeader);
+		if (chunks_.empty() || _header.run != chunks_.back().header.run)
+		{
+			Run run;
+			run.first_chunk = chunks_.size();
+			run.chunk_count = 0;
+			run.record_count = 0;
+			runs_.push_back(run);
+		}
+		Run& run = runs_.back();
+		chunk.first_record = run.record_count;
+		++run.chunk_count;
+		run.record_count += _header.record_count;
+		chunks_.push_back(chunk);
+		return true;
+	}
+
+	std::size_t TrajectoryReader::ChunkOf(int _run, std::size_t _index) const
+	{
+		const Run& run = runs_[_run];
+		const auto first = chunks_.begin() + run.first_chunk;
+		const auto last = first + run.chunk_count;
+		const auto chunk = std::upper_bound(first, last, _index,
+											[](std::size_t _i, const Chunk& _chunk) { return _i < _chunk.first_record; });
+		return static_cast<std::size_t>(chunk - chunks_.begin()) - 1;
+	}
+
+	bool TrajectoryReader::Decompress(std::size_t _chunk)
+	{
+		if (cached_chunk_ == _chunk)
+		{
+			return true;
+		}
+		const Chunk& chunk = chunks_[_chunk];
+		cache_.resize(chunk.header.record_count);
+		if (!Decode(chunk.payload, chunk.header.payload_size, chunk.header.record_count, cache_.data()))
+		{
+			cached_chunk_ = kNoChunk;
+			return false;
+		}
+		cached_chunk_ = _chunk;
+		return true;
+	}
+}
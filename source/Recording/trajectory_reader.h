@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "trajectory_format.h"
+
+namespace car
+{
+	// TrajectoryReader
+	// Random access to a trajectory log written by TrajectoryRecorder. The file is memory mapped
+	// and only the chunk holding the requested record is decompressed, so scrubbing through a long
+	// run touches a few kilobytes per seek whatever the size of the log.
+	class TrajectoryReader
+	{
+	public:
+
+		TrajectoryReader();
+		~TrajectoryReader();
+
+		// Open
+		// Maps _file_name and builds the run table from its chunk index, or from the chunk headers
+		// if the recorder was not closed. Closes any open log first.
+		// OUT:		False if the file cannot be mapped or is not a trajectory log
+		bool Open(const std::string& _file_name);
+
+		void Close();
+
+		// Read
+		// IN:		Run and record index within the run
+		// OUT:		False if either is out of range or the chunk is corrupt
+		bool Read(int _run, std::size_t _index, TrajectoryRecord& _record);
+
+		// ReadRun
+		// Decompresses every record of a run into _records.
+		bool ReadRun(int _run, std::vector<TrajectoryRecord>& _records);
+
+		// Find
+		// IN:		Run and time
+		// OUT:		Index of the last record at or before _time, clamped to the run
+		std::size_t Find(int _run, double _time);
+
+		inline bool IsOpen() const { return data_ != nullptr; }
+		inline int GetRunCount() const { return static_cast<int>(runs_.size()); }
+		inline std::size_t GetRecordCount(int _run) const { return runs_[_run].record_count; }
+		inline double GetStartTime(int _run) const { return chunks_[runs_[_run].first_chunk].header.first_time; }
+		inline double GetEndTime(int _run) const { return chunks_[runs_[_run].first_chunk + runs_[_run].chunk_count - 1].header.last_time; }
+
+	private:
+
+		TrajectoryReader(const TrajectoryReader&);
+		TrajectoryReader& operator=(const TrajectoryReader&);
+
+		struct Chunk
+		{
+			trajectory_format::ChunkHeader header;
+			const unsigned char* payload;
+			// Index of the chunk's first record within its run.
+			std::size_t first_record;
+		};
+
+		struct Run
+		{
+			std::size_t first_chunk;
+			std::size_t chunk_count;
+			std::size_t record_count;
+		};
+
+		bool Map(const std::string& _file_name);
+		void Unmap();
+		bool ReadIndex();
+		bool ScanChunks();
+		bool AddChunk(const trajectory_format::ChunkHeader& _header, std::uint64_t _offset);
+		// Chunk of _run holding record _index.
+		std::size_t ChunkOf(int _run, std::size_t _index) const;
+		bool Decompress(std::size_t _chunk);
+
+		const unsigned char* data_;
+		std::size_t size_;
+		// Platform file and mapping handles, only used on Windows.
+		void* file_handle_;
+		void* mapping_handle_;
+
+		std::vector<Chunk> chunks_;
+		std::vector<Run> runs_;
+
+		// The most recently decompressed chunk.
+		std::size_t cached_chunk_;
+		std::vector<TrajectoryRecord> cache_;
+	};
+}
@@ -0,0 +1,185 @@
+#include "trajectory_recorder.h"
+#include <cstring>
+
+namespace car
+{
+	using namespace trajectory_format;
+
+	TrajectoryRecorder::TrajectoryRecorder() :
+		open_(false),
+		stopping_(false),
+		back_run_(0),
+		back_pending_(false),
+		offset_(0),
+		failed_(false),
+		chunk_records_(kDefaultChunkRecords),
+		run_(0),
+		run_records_(0),
+		record_count_(0),
+		stalls_(0)
+	{}
+
+	TrajectoryRecorder::~TrajectoryRecorder()
+	{
+		Close();
+	}
+
+	bool TrajectoryRecorder::Open(const std::string& _file_name, std::uint32_t _chunk_records)
+	{
+		Close();
+		if (_chunk_records < 1)
+		{
+			return false;
+		}
+
+		file_.open(_file_name, std::ios::binary | std::ios::trunc);
+		if (!file_)
+		{
+			return false;
+		}
+
+		FileHeader header;
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.chunk_records = _chunk_records;
+		header.reserved = 0;
+		file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		chunk_records_ = _chunk_records;
+		front_.clear();
+		front_.reserve(chunk_records_);
+		back_.clear();
+		back_.reserve(chunk_records_);
+		back_pending_ = false;
+		index_.clear();
+		offset_ = sizeof(header);
+		failed_ = !file_;
+		run_ = 0;
+		run_records_ = 0;
+		record_count_ = 0;
+		stalls_ = 0;
+		stopping_ = false;
+		open_ = true;
+		writer_ = std::thread(&TrajectoryRecorder::WriterLoop, this);
+		return true;
+	}
+
+	void TrajectoryRecorder::BeginRun()
+	{
+		if (!open_ || run_records_ == 0)
+		{
+			return;
+		}
+		if (!front_.empty())
+		{
+			Submit();
+		}
+		++run_;
+		run_records_ = 0;
+	}
+
+	void TrajectoryRecorder::Record(const TrajectoryRecord& _record)
+	{
+		if (!open_)
+		{
+			return;
+		}
+		front_.push_back(_record);
+		++run_records_;
+		++record_count_;
+		if (front_.size() >= chunk_records_)
+		{
+			Submit();
+		}
+	}
+
+	bool TrajectoryRecorder::Close()
+	{
+		if (!open_)
+		{
+			return true;
+		}
+		if (!front_.empty())
+		{
+			Submit();
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		condition_.notify_all();
+		writer_.join();
+
+		FileTrailer trailer;
+		trailer.index_offset = offset_;
+		trailer.chunk_count = index_.size();
+		std::memcpy(trailer.magic, kMagic, sizeof(kMagic));
+		trailer.version = kVersion;
+		if (!index_.empty())
+		{
+			file_.write(reinterpret_cast<const char*>(index_.data()), index_.size() * sizeof(ChunkIndexEntry));
+		}
+		file_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+		file_.close();
+		failed_ = failed_ || !file_;
+
+		open_ = false;
+		return !failed_;
+	}
+
+	void TrajectoryRecorder::Submit()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (back_pending_)
+			{
+				++stalls_;
+				condition_.wait(lock, [this] { return !back_pending_; });
+			}
+			front_.swap(back_);
+			back_run_ = run_;
+			back_pending_ = true;
+		}
+		condition_.notify_all();
+		front_.clear();
+	}
+
+	void TrajectoryRecorder::WriterLoop()
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condition_.wait(lock, [this] { return back_pending_ || stopping_; });
+				if (!back_pending_)
+				{
+					return;
+				}
+			}
+
+			payload_.clear();
+			Encode(back_.data(), back_.size(), payload_);
+
+			ChunkIndexEntry entry;
+			entry.offset = offset_;
+			entry.header.run = back_run_;
+			entry.header.record_count = static_cast<std::uint32_t>(back_.size());
+			entry.header.payload_size = static_cast<std::uint32_t>(payload_.size());
+			entry.header.reserved = 0;
+			entry.header.first_time = back_.front().time;
+			entry.header.last_time = back_.back().time;
+			file_.write(reinterpret_cast<const char*>(&entry.header), sizeof(entry.header));
+			file_.write(reinterpret_cast<const char*>(payload_.data()), payload_.size());
+			failed_ = failed_ || !file_;
+			index_.push_back(entry);
+			offset_ += sizeof(entry.header) + payload_.size();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				back_.clear();
+				back_pending_ = false;
+			}
+			condition_.notify_all();
+		}
+	}
+}
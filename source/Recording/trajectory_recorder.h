@@ -0,0 +1,91 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trajectory_format.h"
+
+namespace car
+{
+	// TrajectoryRecorder
+	// Streams per-step records into a chunked, compressed trajectory log (see trajectory_format.h).
+	// Records are appended to a front buffer by the simulation thread; a full buffer is swapped
+	// with the back buffer, which a background thread compresses and writes while the front
+	// fills again. Record() only waits if the writer is still busy with the previous chunk
+	// when the next one fills, which is counted by GetStalls().
+	// Record(), BeginRun() and Close() must not be called concurrently.
+	class TrajectoryRecorder
+	{
+	public:
+
+		// 4 seconds of the app's 1 kHz simulation per chunk.
+		static const std::uint32_t kDefaultChunkRecords = 4096;
+
+		TrajectoryRecorder();
+		~TrajectoryRecorder();
+
+		// Open
+		// Creates or truncates _file_name and starts the writer thread. Closes any open log first.
+		// IN:		File name, records per chunk (at least one)
+		// OUT:		False if the file cannot be created
+		bool Open(const std::string& _file_name, std::uint32_t _chunk_records = kDefaultChunkRecords);
+
+		// BeginRun
+		// Ends the current run so following records start a new one.
+		// Does nothing if the current run has no records yet.
+		void BeginRun();
+
+		// Record
+		// Appends one record to the current run. Does nothing if no log is open.
+		void Record(const TrajectoryRecord& _record);
+
+		// Close
+		// Writes any buffered records and the chunk index, then closes the file.
+		// OUT:		False if any write failed since Open()
+		bool Close();
+
+		inline bool IsOpen() const { return open_; }
+		inline std::uint64_t GetRecordCount() const { return record_count_; }
+		inline std::uint32_t GetRunCount() const { return run_ + (run_records_ ? 1 : 0); }
+		// Chunks for which Record() had to wait on the writer thread.
+		inline std::uint64_t GetStalls() const { return stalls_; }
+
+	private:
+
+		TrajectoryRecorder(const TrajectoryRecorder&);
+		TrajectoryRecorder& operator=(const TrajectoryRecorder&);
+
+		// Hands the front buffer to the writer thread, waiting if it still holds the last one.
+		void Submit();
+		void WriterLoop();
+
+		std::ofstream file_;
+		std::thread writer_;
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		bool open_;
+		bool stopping_;
+
+		// Filled by Record() on the caller's thread.
+		std::vector<TrajectoryRecord> front_;
+		// Owned by the writer thread while back_pending_ is set.
+		std::vector<TrajectoryRecord> back_;
+		std::uint32_t back_run_;
+		bool back_pending_;
+
+		// Writer thread only until it has been joined.
+		std::vector<unsigned char> payload_;
+		std::vector<trajectory_format::ChunkIndexEntry> index_;
+		std::uint64_t offset_;
+		bool failed_;
+
+		std::uint32_t chunk_records_;
+		std::uint32_t run_;
+		std::uint64_t run_records_;
+		std::uint64_t record_count_;
+		std::uint64_t stalls_;
+	};
+}
@@ -0,0 +1,116 @@
+#include "fleet_renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <Agnostic\profiler.h>
+#include <SFML\Graphics\Image.hpp>
+#include <SFML\Graphics\RenderTarget.hpp>
+
+namespace
+{
+	// Transparent border around each sprite in the atlas, so smoothing never samples a neighbour.
+	const unsigned kAtlasPadding = 2;
+	// Cars never shrink below this, so a very large fleet stays visible as overlapping lanes.
+	const float kMinScale = 0.05f;
+	const float kDegreesToRadians = 3.14159265358979f / 180.0f;
+}
+
+FleetRenderer::FleetRenderer() :
+	vertices_(sf::Quads),
+	count_(0),
+	displacement_scale_(1.0f),
+	lane_height_(0.0f),
+	scale_(1.0f)
+{}
+
+bool FleetRenderer::Initialize(const sf::Texture& _car, const sf::Texture& _steering_indicator)
+{
+	const sf::Image car = _car.copyToImage();
+	const sf::Image indicator = _steering_indicator.copyToImage();
+	const sf::Vector2u car_size = car.getSize();
+	const sf::Vector2u indicator_size = indicator.getSize();
+
+	// Side by side: | pad | car | pad | pad | indicator | pad |
+	sf::Image atlas;
+	atlas.create(car_size.x + indicator_size.x + kAtlasPadding * 4,
+				 std::max(car_size.y, indicator_size.y) + kAtlasPadding * 2,
+				 sf::Color::Transparent);
+	atlas.copy(car, kAtlasPadding, kAtlasPadding);
+	atlas.copy(indicator, car_size.x + kAtlasPadding * 3, kAtlasPadding);
+	if (!atlas_.loadFromImage(atlas))
+	{
+		return false;
+	}
+	atlas_.setSmooth(true);
+
+	car_rect_ = sf::FloatRect(static_cast<float>(kAtlasPadding), static_cast<float>(kAtlasPadding),
+							  static_cast<float>(car_size.x), static_cast<float>(car_size.y));
+	indicator_rect_ = sf::FloatRect(static_cast<float>(car_size.x + kAtlasPadding * 3), static_cast<float>(kAtlasPadding),
+									static_cast<float>(indicator_size.x), static_cast<float>(indicator_size.y));
+	return true;
+}
+
+void FleetRenderer::SetLayout(const sf::FloatRect& _area, std::size_t _count, float _displacement_scale)
+{
+	area_ = _area;
+	count_ = _count;
+	displacement_scale_ = _displacement_scale;
+	lane_height_ = _area.height / static_cast<float>(std::max<std::size_t>(_count, 1));
+	scale_ = car_rect_.height > 0.0f ? std::min(std::max(lane_height_ / car_rect_.height, kMinScale), 1.0f) : 1.0f;
+	// Two quads per car. Resizing once here means Update() only ever overwrites vertices.
+	vertices_.resize(_count * 8);
+}
+
+void FleetRenderer::Update(const car::FleetState& _previous, const car::FleetState& _current, float _alpha)
+{
+	if (_current.displacement.size() < count_ || _previous.displacement.size() < count_)
+	{
+		return;
+	}
+	AGN_PROFILE_SCOPE("render.fleet_vertices");
+
+	const float centre = area_.left + area_.width * 0.5f;
+	const double* previous_displacement = _previous.displacement.data();
+	const double* previous_velocity = _previous.velocity.data();
+	const double* previous_steering = _previous.steering.data();
+	const double* displacement = _current.displacement.data();
+	const double* velocity = _current.velocity.data();
+	const double* steering = _current.steering.data();
+	for (std::size_t i = 0; i < count_; ++i)
+	{
+		const double d = previous_displacement[i] + (displacement[i] - previous_displacement[i]) * _alpha;
+		const double v = previous_velocity[i] + (velocity[i] - previous_velocity[i]) * _alpha;
+		const double s = previous_steering[i] + (steering[i] - previous_steering[i]) * _alpha;
+
+		const sf::Vector2f position(centre + static_cast<float>(d) * displacement_scale_,
+									area_.top + (static_cast<float>(i) + 0.5f) * lane_height_);
+		sf::Vertex* quads = &vertices_[i * 8];
+		WriteQuad(quads, car_rect_, position, static_cast<float>(v) * 90.0f, scale_);
+		WriteQuad(quads + 4, indicator_rect_, position, static_cast<float>(s) * 90.0f, scale_);
+	}
+}
+
+void FleetRenderer::draw(sf::RenderTarget& _target, sf::RenderStates _states) const
+{
+	_states.texture = &atlas_;
+	_target.draw(vertices_, _states);
+}
+
+void FleetRenderer::WriteQuad(sf::Vertex* _quad, const sf::FloatRect& _rect, sf::Vector2f _position, float _degrees, float _scale)
+{
+	// Same as a sprite with its origin at the centre: rotate the corners clockwise (y points down).
+	const float radians = _degrees * kDegreesToRadians;
+	const float cosine = std::cos(radians);
+	const float sine = std::sin(radians);
+	const float half_width = _rect.width * 0.5f * _scale;
+	const float half_height = _rect.height * 0.5f * _scale;
+	const float corners[4][2] = { { -half_width, -half_height }, { half_width, -half_height },
+								  { half_width, half_height }, { -half_width, half_height } };
+	const float texture[4][2] = { { _rect.left, _rect.top }, { _rect.left + _rect.width, _rect.top },
+								  { _rect.left + _rect.width, _rect.top + _rect.height }, { _rect.left, _rect.top + _rect.height } };
+	for (int c = 0; c < 4; ++c)
+	{
+		_quad[c].position = sf::Vector2f(_position.x + corners[c][0] * cosine - corners[c][1] * sine,
+										 _position.y + corners[c][0] * sine + corners[c][1] * cosine);
+		_quad[c].texCoords = sf::Vector2f(texture[c][0], texture[c][1]);
+	}
+}
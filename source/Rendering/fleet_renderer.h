@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <SFML\Graphics\Drawable.hpp>
+#include <SFML\Graphics\Rect.hpp>
+#include <SFML\Graphics\Texture.hpp>
+#include <SFML\Graphics\VertexArray.hpp>
+#include "..\Simulation\fleet.h"
+
+// FleetRenderer
+// Draws every car of a fleet and its steering indicator with a single draw call. Both sprites
+// are packed into one atlas texture and each frame one quad per sprite is written into a vertex
+// array that is sized once, so drawing thousands of cars costs one texture bind and one upload.
+// Cars run along horizontal lanes, one per car in fleet order, shrunk to fit the lane height.
+class FleetRenderer : public sf::Drawable
+{
+public:
+
+	FleetRenderer();
+
+	// Initialize
+	// Builds the atlas from the car and steering indicator textures.
+	// OUT:		False if the atlas texture cannot be created
+	bool Initialize(const sf::Texture& _car, const sf::Texture& _steering_indicator);
+
+	// SetLayout
+	// IN:		Area the lanes are spread over, number of cars and pixels per unit of displacement
+	void SetLayout(const sf::FloatRect& _area, std::size_t _count, float _displacement_scale);
+
+	// Update
+	// Writes the quads for every car, blending from _previous to _current like the single car view.
+	void Update(const car::FleetState& _previous, const car::FleetState& _current, float _alpha);
+
+private:
+
+	void draw(sf::RenderTarget& _target, sf::RenderStates _states) const override;
+
+	// Writes the four corners of _rect's texture, centred on _position and rotated by _degrees.
+	static void WriteQuad(sf::Vertex* _quad, const sf::FloatRect& _rect, sf::Vector2f _position, float _degrees, float _scale);
+
+	sf::Texture atlas_;
+	sf::FloatRect car_rect_;
+	sf::FloatRect indicator_rect_;
+
+	sf::VertexArray vertices_;
+	sf::FloatRect area_;
+	std::size_t count_;
+	float displacement_scale_;
+	float lane_height_;
+	float scale_;
+};
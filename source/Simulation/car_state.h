@@ -0,0 +1,12 @@
+#pragma once
+
+namespace car
+{
+	struct CarState
+	{
+		double displacement;
+		double velocity;
+		// Controller output at this displacement and velocity, used as the acceleration.
+		double steering;
+	};
+}
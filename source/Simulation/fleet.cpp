@@ -0,0 +1,109 @@
+#include "fleet.h"
+#include <algorithm>
+#include <cmath>
+#include <Agnostic/profiler.h>
+
+namespace car
+{
+	namespace
+	{
+		// Cars advanced per task. Large enough to amortise submitting a task and to keep the
+		// batch kernels on full vectors, small enough to spread a few thousand cars over cores.
+		const std::size_t kBlockSize = 1024;
+	}
+
+	template <typename Task>
+	void Fleet::ForEachBlock(std::size_t _count, Task _task)
+	{
+		if (_count <= kBlockSize)
+		{
+			// Not worth waking the workers.
+			if (_count > 0)
+			{
+				_task(*controllers_[0], 0, _count);
+			}
+			return;
+		}
+		for (std::size_t begin = 0; begin < _count; begin += kBlockSize)
+		{
+			const std::size_t end = std::min(begin + kBlockSize, _count);
+			pool_.Submit([this, &_task, begin, end](unsigned _worker)
+			{
+				_task(*controllers_[_worker], begin, end);
+			});
+		}
+		pool_.Wait();
+	}
+
+	Fleet::Fleet(const FlatController& _compiled, unsigned _threads) :
+		pool_(_threads),
+		time_(0.0)
+	{
+		for (unsigned i = 0; i < pool_.GetThreadCount(); ++i)
+		{
+			controllers_.emplace_back(new BatchController(_compiled));
+		}
+	}
+
+	void Fleet::Reset(const std::vector<CarState>& _initial)
+	{
+		initial_.displacement.resize(_initial.size());
+		initial_.velocity.resize(_initial.size());
+		initial_.steering.resize(_initial.size());
+		for (std::size_t i = 0; i < _initial.size(); ++i)
+		{
+			initial_.displacement[i] = _initial[i].displacement;
+			initial_.velocity[i] = _initial[i].velocity;
+		}
+		ForEachBlock(_initial.size(), [this](BatchController& _controller, std::size_t _begin, std::size_t _end)
+		{
+			_controller.Steering(&initial_.displacement[_begin], &initial_.velocity[_begin],
+								 &initial_.steering[_begin], _end - _begin);
+		});
+		Restart();
+	}
+
+	void Fleet::Restart()
+	{
+		current_ = initial_;
+		previous_ = initial_;
+		time_ = 0.0;
+	}
+
+	void Fleet::Step(double _timestep)
+	{
+		AGN_PROFILE_SCOPE("simulation.fleet_step");
+		// Assigning equal sized vectors copies without reallocating.
+		previous_ = current_;
+		ForEachBlock(GetCount(), [this, _timestep](BatchController& _controller, std::size_t _begin, std::size_t _end)
+		{
+			double* displacement = &current_.displacement[_begin];
+			double* velocity = &current_.velocity[_begin];
+			double* steering = &current_.steering[_begin];
+			const std::size_t count = _end - _begin;
+			{
+				AGN_PROFILE_SCOPE("simulation.integrate");
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					velocity[i] += steering[i] * _timestep;
+					displacement[i] += velocity[i] * _timestep;
+				}
+			}
+			_controller.Steering(displacement, velocity, steering, count);
+		});
+		time_ += _timestep;
+	}
+
+	std::size_t Fleet::CountCentred(double _tolerance) const
+	{
+		std::size_t centred = 0;
+		for (std::size_t i = 0; i < GetCount(); ++i)
+		{
+			if (std::abs(current_.displacement[i]) <= _tolerance && std::abs(current_.velocity[i]) <= _tolerance)
+			{
+				++centred;
+			}
+		}
+		return centred;
+	}
+}
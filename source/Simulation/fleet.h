@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <Agnostic/work_stealing_pool.h>
+#include "../Controller/batch_controller.h"
+#include "car_state.h"
+
+namespace car
+{
+	// Structure of arrays state of a fleet of cars, indexed by car.
+	struct FleetState
+	{
+		std::vector<double> displacement;
+		std::vector<double> velocity;
+		std::vector<double> steering;
+	};
+
+	// Fleet
+	// Steps many cars at once for live visualisation of initial condition sweeps. State is kept
+	// as plain arrays so blocks of cars are advanced with the same semi-implicit Euler update as
+	// Simulator::Step() and steered by a BatchController per worker, and so a renderer can read
+	// positions and rotations straight out of them.
+	class Fleet
+	{
+	public:
+
+		// Copies the compiled tables into one BatchController per worker thread.
+		// IN:		Compiled two input controller, worker threads (zero for hardware_concurrency())
+		explicit Fleet(const FlatController& _compiled, unsigned _threads = 0);
+
+		// Reset
+		// IN:		Initial states (steering is recomputed, so it may be left zero)
+		void Reset(const std::vector<CarState>& _initial);
+
+		// Restart
+		// Returns every car to the initial states of the last Reset().
+		void Restart();
+
+		// Step
+		// Keeps the current state as the previous one and advances every car by _timestep.
+		void Step(double _timestep);
+
+		inline std::size_t GetCount() const { return current_.displacement.size(); }
+		inline double GetTime() const { return time_; }
+		inline const FleetState& GetCurrent() const { return current_; }
+		inline const FleetState& GetPrevious() const { return previous_; }
+
+		// CountCentred
+		// OUT:		Cars whose displacement and velocity magnitudes are both within _tolerance
+		std::size_t CountCentred(double _tolerance) const;
+
+	private:
+
+		// Runs _task(controller, begin, end) over blocks of _count cars on the pool and waits.
+		template <typename Task>
+		void ForEachBlock(std::size_t _count, Task _task);
+
+		agn::WorkStealingPool pool_;
+		std::vector<std::unique_ptr<BatchController>> controllers_;
+
+		FleetState initial_;
+		FleetState current_;
+		FleetState previous_;
+		double time_;
+	};
+}
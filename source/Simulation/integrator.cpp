@@ -0,0 +1,185 @@
+#include "integrator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace car
+{
+	namespace
+	{
+		// Dormand-Prince 5(4) tableau.
+		const double a21 = 1.0 / 5.0;
+		const double a31 = 3.0 / 40.0, a32 = 9.0 / 40.0;
+		const double a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0;
+		const double a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0, a54 = -212.0 / 729.0;
+		const double a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0, a64 = 49.0 / 176.0, a65 = -5103.0 / 18656.0;
+		// Fifth order weights, also the last stage's coefficients (first same as last).
+		const double b1 = 35.0 / 384.0, b3 = 500.0 / 1113.0, b4 = 125.0 / 192.0, b5 = -2187.0 / 6784.0, b6 = 11.0 / 84.0;
+		// Difference between the fifth and embedded fourth order weights.
+		const double e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0, e5 = -17253.0 / 339200.0, e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+		// Step size controller limits and safety factor.
+		const double kSafety = 0.9;
+		const double kMinimumScale = 0.2;
+		const double kMaximumScale = 5.0;
+	}
+
+	CarState EulerIntegrator::Advance(SteeringController& _controller, const CarState& _state, double _duration)
+	{
+		CarState next;
+		next.displacement = _state.displacement + _state.velocity * _duration;
+		next.velocity = _state.velocity + _state.steering * _duration;
+		next.steering = Acceleration(_controller, next.displacement, next.velocity);
+		return next;
+	}
+
+	CarState SemiImplicitEulerIntegrator::Advance(SteeringController& _controller, const CarState& _state, double _duration)
+	{
+		CarState next;
+		next.velocity = _state.velocity + _state.steering * _duration;
+		next.displacement = _state.displacement + next.velocity * _duration;
+		next.steering = Acceleration(_controller, next.displacement, next.velocity);
+		return next;
+	}
+
+	CarState RK4Integrator::Advance(SteeringController& _controller, const CarState& _state, double _duration)
+	{
+		const double h = _duration;
+		const double x = _state.displacement;
+		const double v = _state.velocity;
+
+		const double v1 = v;
+		const double a1 = _state.steering;
+		const double v2 = v + 0.5 * h * a1;
+		const double a2 = Acceleration(_controller, x + 0.5 * h * v1, v2);
+		const double v3 = v + 0.5 * h * a2;
+		const double a3 = Acceleration(_controller, x + 0.5 * h * v2, v3);
+		const double v4 = v + h * a3;
+		const double a4 = Acceleration(_controller, x + h * v3, v4);
+
+		CarState next;
+		next.displacement = x + h / 6.0 * (v1 + 2.0 * v2 + 2.0 * v3 + v4);
+		next.velocity = v + h / 6.0 * (a1 + 2.0 * a2 + 2.0 * a3 + a4);
+		next.steering = Acceleration(_controller, next.displacement, next.velocity);
+		return next;
+	}
+
+	RK45Integrator::RK45Integrator(double _tolerance, double _minimum_step) :
+		tolerance_(_tolerance),
+		minimum_step_(_minimum_step),
+		step_(0.0),
+		rejected_steps_(0)
+	{}
+
+	CarState RK45Integrator::Advance(SteeringController& _controller, const CarState& _state, double _duration)
+	{
+		// Nothing to advance, and a non-positive duration must not become the next step size.
+		if (!(_duration > 0.0))
+		{
+			return _state;
+		}
+
+		CarState state = _state;
+		double remaining = _duration;
+		if (step_ <= 0.0)
+		{
+			step_ = _duration;
+		}
+
+		while (remaining > 0.0)
+		{
+			const bool last = step_ >= remaining;
+			const double h = last ? remaining : step_;
+			const double x = state.displacement;
+			const double v = state.velocity;
+
+			// Stage derivatives: displacement' is the stage velocity, velocity' its steering.
+			const double v1 = v;
+			const double a1 = state.steering;
+			const double v2 = v + h * (a21 * a1);
+			const double a2 = Acceleration(_controller, x + h * (a21 * v1), v2);
+			const double v3 = v + h * (a31 * a1 + a32 * a2);
+			const double a3 = Acceleration(_controller, x + h * (a31 * v1 + a32 * v2), v3);
+			const double v4 = v + h * (a41 * a1 + a42 * a2 + a43 * a3);
+			const double a4 = Acceleration(_controller, x + h * (a41 * v1 + a42 * v2 + a43 * v3), v4);
+			const double v5 = v + h * (a51 * a1 + a52 * a2 + a53 * a3 + a54 * a4);
+			const double a5 = Acceleration(_controller, x + h * (a51 * v1 + a52 * v2 + a53 * v3 + a54 * v4), v5);
+			const double v6 = v + h * (a61 * a1 + a62 * a2 + a63 * a3 + a64 * a4 + a65 * a5);
+			const double a6 = Acceleration(_controller, x + h * (a61 * v1 + a62 * v2 + a63 * v3 + a64 * v4 + a65 * v5), v6);
+
+			CarState next;
+			next.displacement = x + h * (b1 * v1 + b3 * v3 + b4 * v4 + b5 * v5 + b6 * v6);
+			next.velocity = v + h * (b1 * a1 + b3 * a3 + b4 * a4 + b5 * a5 + b6 * a6);
+			next.steering = Acceleration(_controller, next.displacement, next.velocity);
+			const double v7 = next.velocity;
+			const double a7 = next.steering;
+
+			const double displacement_error = h * (e1 * v1 + e3 * v3 + e4 * v4 + e5 * v5 + e6 * v6 + e7 * v7);
+			const double velocity_error = h * (e1 * a1 + e3 * a3 + e4 * a4 + e5 * a5 + e6 * a6 + e7 * a7);
+			const double displacement_scale = tolerance_ * (1.0 + std::max(std::abs(x), std::abs(next.displacement)));
+			const double velocity_scale = tolerance_ * (1.0 + std::max(std::abs(v), std::abs(next.velocity)));
+			const double error = std::max(std::abs(displacement_error) / displacement_scale,
+										  std::abs(velocity_error) / velocity_scale);
+
+			const double scale = error > 0.0 ?
+				std::min(kMaximumScale, std::max(kMinimumScale, kSafety * std::pow(error, -0.2))) : kMaximumScale;
+			const bool accepted = error <= 1.0 || h <= minimum_step_;
+			if (accepted)
+			{
+				state = next;
+				remaining = last ? 0.0 : remaining - h;
+				// A step cut short to land on _duration says nothing about how large the next can be.
+				step_ = last && h < step_ ? std::max(step_, h * scale) : h * scale;
+			}
+			else
+			{
+				++rejected_steps_;
+				step_ = h * scale;
+			}
+			step_ = std::max(step_, minimum_step_);
+		}
+
+		return state;
+	}
+
+	Integrator* CreateIntegrator(INTEGRATION _integration, double _tolerance)
+	{
+		switch (_integration)
+		{
+		case INTEGRATION::EULER:
+			return new EulerIntegrator;
+		case INTEGRATION::RK4:
+			return new RK4Integrator;
+		case INTEGRATION::RK45:
+			return new RK45Integrator(_tolerance);
+		case INTEGRATION::SEMI_IMPLICIT_EULER:
+		default:
+			return new SemiImplicitEulerIntegrator;
+		}
+	}
+
+	bool ParseIntegration(const char* _name, INTEGRATION& _integration)
+	{
+		if (std::strcmp(_name, "euler") == 0)
+		{
+			_integration = INTEGRATION::EULER;
+		}
+		else if (std::strcmp(_name, "semi-implicit") == 0)
+		{
+			_integration = INTEGRATION::SEMI_IMPLICIT_EULER;
+		}
+		else if (std::strcmp(_name, "rk4") == 0)
+		{
+			_integration = INTEGRATION::RK4;
+		}
+		else if (std::strcmp(_name, "rk45") == 0)
+		{
+			_integration = INTEGRATION::RK45;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+}
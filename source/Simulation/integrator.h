@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include "../Controller/steering_controller.h"
+#include "car_state.h"
+
+namespace car
+{
+	// The car obeys displacement' = velocity and velocity' = steering(displacement, velocity),
+	// with the steering controller as the force function.
+	enum class INTEGRATION { EULER, SEMI_IMPLICIT_EULER, RK4, RK45 };
+
+	// Integrator
+	// Advances a car state through time. Every method leaves the returned state's steering
+	// evaluated at its displacement and velocity, and reuses the incoming state's steering as
+	// its first stage, so evaluations are never repeated between calls.
+	// Integrators may hold state (step size, counters), so clone one per thread like controllers.
+	class Integrator
+	{
+	public:
+
+		Integrator() : evaluations_(0) {}
+		virtual ~Integrator() {}
+
+		// Advance
+		// IN:		Controller, state with its steering evaluated, time to advance by
+		// OUT:		State _duration later. Fixed step methods take exactly one step;
+		//			adaptive methods take as many sub-steps as their tolerance needs.
+		virtual CarState Advance(SteeringController& _controller, const CarState& _state, double _duration) = 0;
+		virtual Integrator* Clone() const = 0;
+		virtual const char* GetName() const = 0;
+
+		// Controller evaluations made by Advance() since construction or the last reset.
+		inline std::size_t GetEvaluations() const { return evaluations_; }
+		inline void ResetEvaluations() { evaluations_ = 0; }
+
+	protected:
+
+		inline double Acceleration(SteeringController& _controller, double _displacement, double _velocity)
+		{
+			++evaluations_;
+			return _controller.Steering(_displacement, _velocity);
+		}
+
+	private:
+
+		std::size_t evaluations_;
+	};
+
+	// Explicit (forward) Euler: both derivatives from the start of the step. First order.
+	class EulerIntegrator : public Integrator
+	{
+	public:
+		CarState Advance(SteeringController& _controller, const CarState& _state, double _duration) override;
+		EulerIntegrator* Clone() const override { return new EulerIntegrator(*this); }
+		const char* GetName() const override { return "Euler"; }
+	};
+
+	// Semi-implicit (symplectic) Euler: velocity first, then displacement with the new velocity.
+	// First order but far more stable than explicit Euler for this oscillator. Same as Simulator::Step().
+	class SemiImplicitEulerIntegrator : public Integrator
+	{
+	public:
+		CarState Advance(SteeringController& _controller, const CarState& _state, double _duration) override;
+		SemiImplicitEulerIntegrator* Clone() const override { return new SemiImplicitEulerIntegrator(*this); }
+		const char* GetName() const override { return "Semi-implicit Euler"; }
+	};
+
+	// Classic fourth order Runge-Kutta. Four evaluations per step.
+	class RK4Integrator : public Integrator
+	{
+	public:
+		CarState Advance(SteeringController& _controller, const CarState& _state, double _duration) override;
+		RK4Integrator* Clone() const override { return new RK4Integrator(*this); }
+		const char* GetName() const override { return "RK4"; }
+	};
+
+	// RK45Integrator
+	// Adaptive Dormand-Prince 5(4). Each sub-step estimates its local error from the embedded
+	// fourth order solution and the step grows or shrinks to keep that error within tolerance,
+	// so smooth stretches are crossed in a few large steps and the controller's kinks in small
+	// ones. Six evaluations per accepted or rejected sub-step (the last stage is reused).
+	// The step size carries over between calls to Advance().
+	class RK45Integrator : public Integrator
+	{
+	public:
+
+		// IN:		Local error tolerance, applied to displacement and velocity as
+		//			absolute and relative tolerance alike, and the smallest step allowed
+		explicit RK45Integrator(double _tolerance = 1e-6, double _minimum_step = 1e-9);
+
+		CarState Advance(SteeringController& _controller, const CarState& _state, double _duration) override;
+		RK45Integrator* Clone() const override { return new RK45Integrator(*this); }
+		const char* GetName() const override { return "RK45"; }
+
+		inline double GetTolerance() const { return tolerance_; }
+		// Sub-steps rejected for exceeding the tolerance since construction.
+		inline std::size_t GetRejectedSteps() const { return rejected_steps_; }
+
+	private:
+
+		double tolerance_;
+		double minimum_step_;
+		// Step the next sub-step will try, zero until the first call.
+		double step_;
+		std::size_t rejected_steps_;
+	};
+
+	// CreateIntegrator
+	// IN:		Method and, for RK45, its tolerance
+	// OUT:		New integrator owned by the caller
+	Integrator* CreateIntegrator(INTEGRATION _integration, double _tolerance = 1e-6);
+
+	// ParseIntegration
+	// IN:		"euler", "semi-implicit", "rk4" or "rk45"
+	// OUT:		False if the name is not recognised
+	bool ParseIntegration(const char* _name, INTEGRATION& _integration);
+}
@@ -0,0 +1,160 @@
+#include "simulator.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <Agnostic/profiler.h>
+
+namespace car
+{
+	namespace
+	{
+		// Trajectories handed to a worker at a time. Small enough to balance uneven
+		// thread speeds, large enough that the shared counter is not contended.
+		const std::size_t kChunkSize = 64;
+
+		double AxisValue(double _min, double _max, int _count, int _index)
+		{
+			if (_count <= 1)
+			{
+				return _min;
+			}
+			return _min + (_max - _min) * _index / (_count - 1);
+		}
+	}
+
+	Simulator::Simulator(const SteeringController& _controller, const SimulationSettings& _settings) :
+		controller_(_controller),
+		settings_(_settings)
+	{}
+
+	CarState Simulator::Step(SteeringController& _controller, const CarState& _state, double _timestep)
+	{
+		CarState next;
+		{
+			// State update only, as in Fleet::Step(); the controller is timed by its own zones.
+			AGN_PROFILE_SCOPE("simulation.integrate");
+			next.velocity = _state.velocity + _state.steering * _timestep;
+			next.displacement = _state.displacement + next.velocity * _timestep;
+		}
+		next.steering = _controller.Steering(next.displacement, next.velocity);
+		return next;
+	}
+
+	CarState Simulator::Initialize(SteeringController& _controller, double _displacement, double _velocity)
+	{
+		CarState state;
+		state.displacement = _displacement;
+		state.velocity = _velocity;
+		state.steering = _controller.Steering(_displacement, _velocity);
+		return state;
+	}
+
+	TrajectoryResult Simulator::Simulate(SteeringController& _controller, const CarState& _initial,
+										 const StepObserver& _observer) const
+	{
+		TrajectoryResult result;
+		result.initial = Initialize(_controller, _initial.displacement, _initial.velocity);
+		std::unique_ptr<Integrator> integrator(CreateIntegrator(settings_.integration, settings_.integration_tolerance));
+
+		// Index of the first step of the current unbroken run inside tolerance.
+		int settled_from = 0;
+		CarState state = result.initial;
+		const double side = result.initial.displacement;
+		result.overshoot = 0.0;
+		result.effort = 0.0;
+		if (_observer)
+		{
+			_observer(0.0, state);
+		}
+		for (int step = 0; step < settings_.steps; ++step)
+		{
+			result.effort += std::abs(state.steering) * settings_.timestep;
+			if (std::abs(state.displacement) > settings_.settle_tolerance ||
+				std::abs(state.velocity) > settings_.settle_tolerance)
+			{
+				settled_from = step + 1;
+			}
+			{
+				// Integrators evaluate the controller between their stages, so the whole step is timed.
+				AGN_PROFILE_SCOPE("simulation.step");
+				state = integrator->Advance(_controller, state, settings_.timestep);
+			}
+			if (_observer)
+			{
+				_observer((step + 1) * settings_.timestep, state);
+			}
+
+			const double past_centre = side > 0.0 ? -state.displacement :
+									   side < 0.0 ? state.displacement : std::abs(state.displacement);
+			result.overshoot = std::max(result.overshoot, past_centre);
+		}
+		if (std::abs(state.displacement) > settings_.settle_tolerance ||
+			std::abs(state.velocity) > settings_.settle_tolerance)
+		{
+			settled_from = settings_.steps + 1;
+		}
+
+		result.final = state;
+		result.settled = settled_from <= settings_.steps;
+		result.settling_time = settled_from * settings_.timestep;
+		return result;
+	}
+
+	std::vector<TrajectoryResult> Simulator::Run(const std::vector<CarState>& _initial) const
+	{
+		std::vector<TrajectoryResult> results(_initial.size());
+
+		unsigned thread_count = settings_.threads ? settings_.threads : std::thread::hardware_concurrency();
+		thread_count = std::max(1u, thread_count);
+		const std::size_t chunks = (_initial.size() + kChunkSize - 1) / kChunkSize;
+		thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, std::max<std::size_t>(chunks, 1)));
+
+		std::atomic<std::size_t> next_chunk(0);
+		auto worker = [&]()
+		{
+			std::unique_ptr<SteeringController> controller(controller_.Clone());
+			for (std::size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++)
+			{
+				const std::size_t end = std::min(_initial.size(), (chunk + 1) * kChunkSize);
+				for (std::size_t i = chunk * kChunkSize; i < end; ++i)
+				{
+					results[i] = Simulate(*controller, _initial[i]);
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < thread_count; ++i)
+		{
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		return results;
+	}
+
+	std::vector<CarState> Simulator::Grid(double _displacement_min, double _displacement_max, int _displacement_count,
+										  double _velocity_min, double _velocity_max, int _velocity_count)
+	{
+		std::vector<CarState> grid;
+		grid.reserve(static_cast<std::size_t>(std::max(_displacement_count, 0)) * std::max(_velocity_count, 0));
+		for (int d = 0; d < _displacement_count; ++d)
+		{
+			for (int v = 0; v < _velocity_count; ++v)
+			{
+				CarState state;
+				state.displacement = AxisValue(_displacement_min, _displacement_max, _displacement_count, d);
+				state.velocity = AxisValue(_velocity_min, _velocity_max, _velocity_count, v);
+				state.steering = 0.0;
+				grid.push_back(state);
+			}
+		}
+		return grid;
+	}
+}
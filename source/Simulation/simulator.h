@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include "../Controller/steering_controller.h"
+#include "car_state.h"
+#include "integrator.h"
+
+namespace car
+{
+	struct SimulationSettings
+	{
+		double timestep = 0.01;
+		int steps = 1000;
+		// Displacement and velocity magnitudes below this count as settled.
+		double settle_tolerance = 0.05;
+		// Worker threads for Run(). Zero uses std::thread::hardware_concurrency().
+		unsigned threads = 0;
+		// How each timestep is integrated. The default matches Step().
+		INTEGRATION integration = INTEGRATION::SEMI_IMPLICIT_EULER;
+		// Local error tolerance for INTEGRATION::RK45.
+		double integration_tolerance = 1e-6;
+	};
+
+	struct TrajectoryResult
+	{
+		CarState initial;
+		CarState final;
+		// Time after which the car stayed inside the settle tolerance. Only valid if settled.
+		double settling_time;
+		bool settled;
+		// Largest displacement past the centre line on the opposite side to the start.
+		// A car starting on the centre line counts any excursion as overshoot.
+		double overshoot;
+		// Integral of |steering| over the run, i.e. total control effort spent.
+		double effort;
+	};
+
+	// Called with the time and state of every step of a trajectory, including the initial state.
+	typedef std::function<void(double _time, const CarState& _state)> StepObserver;
+
+	// Simulator
+	// Headless car dynamics. Holds no window, console or logger state, so it can be
+	// driven from the interactive app, command line tools or worker threads alike.
+	class Simulator
+	{
+	public:
+
+		// Controller is cloned per worker thread, the original is never evaluated by Run().
+		Simulator(const SteeringController& _controller, const SimulationSettings& _settings);
+
+		// Step
+		// Advances a single car by one semi-implicit Euler step (velocity first, then displacement
+		// with the new velocity) and re-evaluates its steering.
+		// IN:		Controller to evaluate, state to advance, timestep in seconds
+		// OUT:		State after the step
+		static CarState Step(SteeringController& _controller, const CarState& _state, double _timestep);
+
+		// Initialize
+		// IN:		Controller and initial displacement/velocity
+		// OUT:		State with the steering output for those inputs filled in
+		static CarState Initialize(SteeringController& _controller, double _displacement, double _velocity);
+
+		// Simulate
+		// Runs one trajectory for settings.steps timesteps on the calling thread, advancing each
+		// timestep with the configured integration method.
+		// IN:		Controller, initial state and an optional observer of every step
+		TrajectoryResult Simulate(SteeringController& _controller, const CarState& _initial,
+								  const StepObserver& _observer = StepObserver()) const;
+
+		// Run
+		// Runs every initial condition, spread across the configured worker threads.
+		// IN:		Initial states (steering is recomputed, so it may be left zero)
+		// OUT:		One result per initial state, in the same order
+		std::vector<TrajectoryResult> Run(const std::vector<CarState>& _initial) const;
+
+		// Grid
+		// Builds a regular grid of initial conditions, displacement major.
+		// Each axis runs inclusively from min to max; a count of one uses min only.
+		static std::vector<CarState> Grid(double _displacement_min, double _displacement_max, int _displacement_count,
+										  double _velocity_min, double _velocity_max, int _velocity_count);
+
+		inline const SimulationSettings& GetSettings() const { return settings_; }
+
+	private:
+
+		const SteeringController& controller_;
+		SimulationSettings settings_;
+	};
+}
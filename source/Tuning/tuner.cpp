@@ -0,0 +1,355 @@
+#include "tuner.h"
+#include <algorithm>
+#include <sstream>
+#include <Agnostic/work_stealing_pool.h>
+#include "../Controller/engine_controller.h"
+#include "../Controller/flat_controller.h"
+
+namespace car
+{
+	namespace
+	{
+		std::string Format(double _value)
+		{
+			std::ostringstream stream;
+			stream.precision(6);
+			stream << _value;
+			return stream.str();
+		}
+
+		fl::Variable* FindVariable(fl::Engine& _engine, const std::string& _name)
+		{
+			if (_engine.hasInputVariable(_name))
+			{
+				return _engine.getInputVariable(_name);
+			}
+			if (_engine.hasOutputVariable(_name))
+			{
+				return _engine.getOutputVariable(_name);
+			}
+			return nullptr;
+		}
+
+		// a is at least as good as b on every objective and strictly better on one.
+		bool Dominates(const Score& _a, const Score& _b)
+		{
+			const bool no_worse = _a.settling_time <= _b.settling_time &&
+								  _a.overshoot <= _b.overshoot &&
+								  _a.effort <= _b.effort;
+			const bool better = _a.settling_time < _b.settling_time ||
+								_a.overshoot < _b.overshoot ||
+								_a.effort < _b.effort;
+			return no_worse && better;
+		}
+
+		// Ramp, Triangle, Triangle, Triangle, Ramp: the layout PartitionSweep knows how to reshape.
+		bool IsFivePartition(const fl::Variable& _variable)
+		{
+			if (_variable.numberOfTerms() != 5)
+			{
+				return false;
+			}
+			for (int i = 0; i < 5; ++i)
+			{
+				const bool shoulder = i == 0 || i == 4;
+				const fl::Term* term = _variable.getTerm(i);
+				if (shoulder ? !dynamic_cast<const fl::Ramp*>(term) : !dynamic_cast<const fl::Triangle*>(term))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	Tuner::Tuner(const fl::Engine& _base, const TuningSettings& _settings) :
+		base_(_base),
+		settings_(_settings)
+	{
+		if (settings_.suite.empty())
+		{
+			settings_.suite = DefaultSuite();
+		}
+	}
+
+	std::vector<TuningResult> Tuner::Evaluate(const std::vector<Candidate>& _candidates)
+	{
+		std::vector<TuningResult> results(_candidates.size());
+
+		agn::WorkStealingPool pool(settings_.threads);
+		std::vector<std::unique_ptr<fl::Engine>> engines;
+		for (unsigned i = 0; i < pool.GetThreadCount(); ++i)
+		{
+			engines.emplace_back(base_.clone());
+		}
+
+		for (std::size_t i = 0; i < _candidates.size(); ++i)
+		{
+			pool.Submit([&, i](unsigned _worker)
+			{
+				results[i] = ScoreCandidate(*engines[_worker], _candidates[i]);
+			});
+		}
+		pool.Wait();
+
+		return results;
+	}
+
+	TuningResult Tuner::ScoreCandidate(fl::Engine& _engine, const Candidate& _candidate) const
+	{
+		TuningResult result;
+		result.candidate = _candidate;
+		result.valid = false;
+		result.score = car::Score();
+
+		Candidate undo;
+		std::unique_ptr<SteeringController> controller;
+		if (Apply(_engine, _candidate, &undo, result.error))
+		{
+			std::string status;
+			if (!_engine.isReady(&status))
+			{
+				result.error = status;
+			}
+			else if (settings_.exact_engine)
+			{
+				controller.reset(new EngineController(_engine.clone()));
+			}
+			else
+			{
+				FlatController* flat = new FlatController;
+				controller.reset(flat);
+				if (!flat->Compile(_engine, &status))
+				{
+					result.error = status;
+					controller.reset();
+				}
+			}
+		}
+
+		// Put the worker's engine back before scoring; the compiled controller is independent of it.
+		std::string undo_error;
+		std::reverse(undo.terms.begin(), undo.terms.end());
+		std::reverse(undo.rules.begin(), undo.rules.end());
+		Apply(_engine, undo, nullptr, undo_error);
+
+		if (!controller)
+		{
+			return result;
+		}
+
+		const Simulator simulator(*controller, settings_.simulation);
+		const double duration = settings_.simulation.steps * settings_.simulation.timestep;
+		for (const CarState& initial : settings_.suite)
+		{
+			const TrajectoryResult trajectory = simulator.Simulate(*controller, initial);
+			result.score.settling_time += trajectory.settled ? trajectory.settling_time : duration;
+			result.score.overshoot += trajectory.overshoot;
+			result.score.effort += trajectory.effort;
+			result.score.unsettled += trajectory.settled ? 0 : 1;
+		}
+
+		const double count = static_cast<double>(settings_.suite.size());
+		result.score.settling_time /= count;
+		result.score.overshoot /= count;
+		result.score.effort /= count;
+		result.valid = true;
+		return result;
+	}
+
+	bool Tuner::Apply(fl::Engine& _engine, const Candidate& _candidate, Candidate* _undo, std::string& _error)
+	{
+		for (const TermEdit& edit : _candidate.terms)
+		{
+			fl::Variable* variable = FindVariable(_engine, edit.variable);
+			if (!variable || !variable->hasTerm(edit.term))
+			{
+				_error = "No term " + edit.variable + "." + edit.term;
+				return false;
+			}
+			fl::Term* term = variable->getTerm(edit.term);
+			const std::string previous = term->parameters();
+			try
+			{
+				term->configure(edit.parameters);
+			}
+			catch (const fl::Exception& exception)
+			{
+				term->configure(previous);
+				_error = exception.getWhat();
+				return false;
+			}
+			if (_undo)
+			{
+				_undo->terms.push_back(TermEdit{ edit.variable, edit.term, previous });
+			}
+		}
+
+		for (const RuleEdit& edit : _candidate.rules)
+		{
+			fl::RuleBlock* rule_block = _engine.numberOfRuleBlocks() > 0 ? _engine.getRuleBlock(0) : nullptr;
+			if (!rule_block || edit.index < 0 || edit.index >= rule_block->numberOfRules())
+			{
+				_error = "No rule " + std::to_string(edit.index);
+				return false;
+			}
+			fl::Rule* rule = rule_block->getRule(edit.index);
+			const std::string previous = rule->getText();
+			try
+			{
+				rule->load(edit.text, &_engine);
+			}
+			catch (const fl::Exception& exception)
+			{
+				rule->load(previous, &_engine);
+				_error = exception.getWhat();
+				return false;
+			}
+			if (_undo)
+			{
+				_undo->rules.push_back(RuleEdit{ edit.index, previous });
+			}
+		}
+
+		return true;
+	}
+
+	std::vector<std::size_t> Tuner::ParetoFront(const std::vector<TuningResult>& _results)
+	{
+		std::vector<std::size_t> front;
+		for (std::size_t i = 0; i < _results.size(); ++i)
+		{
+			if (!_results[i].valid)
+			{
+				continue;
+			}
+			bool dominated = false;
+			for (std::size_t j = 0; j < _results.size() && !dominated; ++j)
+			{
+				dominated = _results[j].valid && Dominates(_results[j].score, _results[i].score);
+			}
+			if (!dominated)
+			{
+				front.push_back(i);
+			}
+		}
+
+		std::sort(front.begin(), front.end(), [&](std::size_t _a, std::size_t _b)
+		{
+			return _results[_a].score.settling_time < _results[_b].score.settling_time;
+		});
+		return front;
+	}
+
+	std::vector<CarState> Tuner::DefaultSuite(int _per_axis)
+	{
+		return Simulator::Grid(-1.0, 1.0, _per_axis, -1.0, 1.0, _per_axis);
+	}
+
+	std::vector<Candidate> Tuner::PartitionSweep(const fl::Engine& _engine,
+												 const std::vector<double>& _centre_widths,
+												 const std::vector<double>& _inner_peaks)
+	{
+		std::vector<const fl::Variable*> variables;
+		for (int i = 0; i < _engine.numberOfInputVariables(); ++i)
+		{
+			variables.push_back(_engine.getInputVariable(i));
+		}
+		for (int i = 0; i < _engine.numberOfOutputVariables(); ++i)
+		{
+			variables.push_back(_engine.getOutputVariable(i));
+		}
+		variables.erase(std::remove_if(variables.begin(), variables.end(),
+									   [](const fl::Variable* _variable) { return !IsFivePartition(*_variable); }),
+						variables.end());
+
+		std::vector<Candidate> candidates;
+		for (double centre : _centre_widths)
+		{
+			for (double peak : _inner_peaks)
+			{
+				// Non positive widths would collapse or invert the terms.
+				if (centre <= 0.0 || peak <= 0.0)
+				{
+					continue;
+				}
+
+				Candidate candidate;
+				candidate.name = "partition centre=" + Format(centre) + " peak=" + Format(peak);
+				for (const fl::Variable* variable : variables)
+				{
+					const double low = variable->getMinimum();
+					const double high = variable->getMaximum();
+					if (peak >= high || -peak <= low)
+					{
+						continue;
+					}
+					const std::string parameters[5] =
+					{
+						Format(-peak) + " " + Format(low),
+						Format(low) + " " + Format(-peak) + " 0",
+						Format(-centre) + " 0 " + Format(centre),
+						"0 " + Format(peak) + " " + Format(high),
+						Format(peak) + " " + Format(high)
+					};
+					for (int t = 0; t < 5; ++t)
+					{
+						candidate.terms.push_back(TermEdit{ variable->getName(), variable->getTerm(t)->getName(), parameters[t] });
+					}
+				}
+				candidates.push_back(candidate);
+			}
+		}
+		return candidates;
+	}
+
+	std::vector<Candidate> Tuner::RuleNeighbours(const fl::Engine& _engine)
+	{
+		std::vector<Candidate> candidates;
+		if (_engine.numberOfRuleBlocks() == 0 || _engine.numberOfOutputVariables() != 1)
+		{
+			return candidates;
+		}
+
+		const fl::OutputVariable* output = _engine.getOutputVariable(0);
+		const fl::RuleBlock* rule_block = _engine.getRuleBlock(0);
+		for (int r = 0; r < rule_block->numberOfRules(); ++r)
+		{
+			// Consequent term is the last word of "... then Output is Term".
+			const std::string text = rule_block->getRule(r)->getText();
+			const std::size_t split = text.find_last_of(' ');
+			if (split == std::string::npos)
+			{
+				continue;
+			}
+			const std::string consequent = text.substr(split + 1);
+			int term = -1;
+			for (int t = 0; t < output->numberOfTerms(); ++t)
+			{
+				if (output->getTerm(t)->getName() == consequent)
+				{
+					term = t;
+				}
+			}
+			if (term < 0)
+			{
+				continue;
+			}
+
+			for (int shift : { -1, 1 })
+			{
+				const int neighbour = term + shift;
+				if (neighbour < 0 || neighbour >= output->numberOfTerms())
+				{
+					continue;
+				}
+				const std::string replacement = output->getTerm(neighbour)->getName();
+				Candidate candidate;
+				candidate.name = "rule " + std::to_string(r) + " " + consequent + "->" + replacement;
+				candidate.rules.push_back(RuleEdit{ r, text.substr(0, split + 1) + replacement });
+				candidates.push_back(candidate);
+			}
+		}
+		return candidates;
+	}
+}
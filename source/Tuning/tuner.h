@@ -0,0 +1,121 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <fl/Headers.h>
+#include "../Simulation/simulator.h"
+
+namespace car
+{
+	// TermEdit
+	// Replaces the parameters of one term, in the term's own fll syntax (e.g. "-0.2 0.0 0.2").
+	struct TermEdit
+	{
+		std::string variable;
+		std::string term;
+		std::string parameters;
+	};
+
+	// RuleEdit
+	// Replaces the text of rule index in the first rule block.
+	struct RuleEdit
+	{
+		int index;
+		std::string text;
+	};
+
+	struct Candidate
+	{
+		std::string name;
+		std::vector<TermEdit> terms;
+		std::vector<RuleEdit> rules;
+	};
+
+	// Score
+	// Objectives are all minimised. Each is the mean over the test suite, except
+	// unsettled which counts the trajectories that never settled; those contribute
+	// the full run duration as their settling time.
+	struct Score
+	{
+		double settling_time;
+		double overshoot;
+		double effort;
+		int unsettled;
+	};
+
+	struct TuningResult
+	{
+		Candidate candidate;
+		Score score;
+		// False if the candidate could not be applied or compiled; error says why.
+		bool valid;
+		std::string error;
+	};
+
+	struct TuningSettings
+	{
+		SimulationSettings simulation;
+		// Initial conditions every candidate is scored on.
+		std::vector<CarState> suite;
+		// Worker threads, zero for std::thread::hardware_concurrency().
+		unsigned threads = 0;
+		// Score with fl::Engine::process() rather than the compiled FlatController.
+		// Far slower; only needed for engines outside the FlatController subset.
+		bool exact_engine = false;
+	};
+
+	// Tuner
+	// Scores controller variants in parallel. Every worker owns one clone of the base
+	// engine; a candidate's edits are applied to that clone, scored over the suite and
+	// then reverted, so no engine is ever shared between threads or rebuilt per candidate.
+	class Tuner
+	{
+	public:
+
+		// The base engine is cloned per worker and is not modified.
+		Tuner(const fl::Engine& _base, const TuningSettings& _settings);
+
+		// Evaluate
+		// IN:		Candidates to score
+		// OUT:		One result per candidate, in the same order
+		std::vector<TuningResult> Evaluate(const std::vector<Candidate>& _candidates);
+
+		// Apply
+		// Applies a candidate's edits to _engine.
+		// IN:		Engine to edit, candidate, optional candidate receiving the edits that undo this one
+		// OUT:		False, with _error filled in, if an edit names a missing variable, term or rule
+		//			or does not parse. Edits made before the failure are left in _undo.
+		static bool Apply(fl::Engine& _engine, const Candidate& _candidate, Candidate* _undo, std::string& _error);
+
+		// ParetoFront
+		// IN:		Scored results
+		// OUT:		Indices of the valid results no other valid result dominates on settling
+		//			time, overshoot and effort, sorted by settling time
+		static std::vector<std::size_t> ParetoFront(const std::vector<TuningResult>& _results);
+
+		// DefaultSuite
+		// Evenly spaced initial conditions across the full displacement and velocity range.
+		static std::vector<CarState> DefaultSuite(int _per_axis = 7);
+
+		// PartitionSweep
+		// Candidates that reshape the five term partition of every input and output symmetrically.
+		// The centre term is a triangle of half width centre_width, the inner terms peak at
+		// inner_peak and the outer ramps start at inner_peak. Terms are addressed by their index
+		// in each variable, so the base engine's names are kept.
+		// IN:		Engine providing the variable and term names, candidate values for each parameter
+		static std::vector<Candidate> PartitionSweep(const fl::Engine& _engine,
+													 const std::vector<double>& _centre_widths,
+													 const std::vector<double>& _inner_peaks);
+
+		// RuleNeighbours
+		// Candidates that each move one rule's consequent a single term up or down the output.
+		static std::vector<Candidate> RuleNeighbours(const fl::Engine& _engine);
+
+	private:
+
+		TuningResult ScoreCandidate(fl::Engine& _engine, const Candidate& _candidate) const;
+
+		const fl::Engine& base_;
+		TuningSettings settings_;
+	};
+}
@@ -1,13 +1,79 @@
 #include <cstdlib> // For EXIT_SUCCESS
+#include <string>
 #include <agnostic\logger.h>
+#include <agnostic\profiler.h>
 using agn::Log;
 #include "AI_App.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	Log::EnableConsole();
 	sf::RenderWindow window(sf::VideoMode(800, 600), "AI Coursework - Craig Jeffrey (1203086)");
 	AI_App application(window);
+	// --threaded runs the car simulation on its own thread, decoupled from rendering.
+	// --record path writes every simulated step to a trajectory log.
+	// --replay path plays back a trajectory log without running the controller.
+	// --log path also writes log messages and per step diagnostics to a rotating log file.
+	// --controller path loads the fuzzy controller from an .fll file.
+	// --surface n steers the single car from an n x n control surface sampled from the controller.
+	// --surface-file path loads the surface from path if it matches, otherwise samples and saves it there.
+	// --fleet n animates n x n cars started across the whole range of initial conditions.
+	// --profile prefix times simulation, inference and rendering and writes the totals per thread
+	// to prefix.json and a Chrome trace to prefix.trace.json on exit.
+	std::string profile;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg(argv[i]);
+		if (arg == "--threaded")
+		{
+			application.SetThreadedSimulation(true);
+		}
+		else if (arg == "--record" && i + 1 < argc)
+		{
+			application.SetRecordFile(argv[++i]);
+		}
+		else if (arg == "--replay" && i + 1 < argc)
+		{
+			application.SetReplayFile(argv[++i]);
+		}
+		else if (arg == "--controller" && i + 1 < argc)
+		{
+			application.SetControllerFile(argv[++i]);
+		}
+		else if (arg == "--surface" && i + 1 < argc)
+		{
+			application.SetSurfaceSize(std::atoi(argv[++i]));
+		}
+		else if (arg == "--surface-file" && i + 1 < argc)
+		{
+			application.SetSurfaceFile(argv[++i]);
+		}
+		else if (arg == "--fleet" && i + 1 < argc)
+		{
+			application.SetFleetSize(std::atoi(argv[++i]));
+		}
+		else if (arg == "--profile" && i + 1 < argc)
+		{
+			profile = argv[++i];
+			agn::Profiler::SetEnabled(true);
+		}
+		else if (arg == "--log" && i + 1 < argc)
+		{
+			if (!Log::EnableFileLog(argv[++i]))
+			{
+				Log::Error(std::string("Log file ") + argv[i] + " could not be opened.");
+			}
+		}
+	}
 	application.Run();
+	if (!profile.empty())
+	{
+		agn::Profiler::SetEnabled(false);
+		if (!agn::Profiler::WriteReport(profile + ".json") || !agn::Profiler::WriteTrace(profile + ".trace.json"))
+		{
+			Log::Error("Profile " + profile + ".json could not be written.");
+		}
+	}
+	Log::DisableFileLog();
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
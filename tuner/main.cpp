@@ -0,0 +1,212 @@
+// Controller tuning runner.
+// Scores variants of the fuzzy controller across a suite of initial conditions on every
+// core and prints the Pareto front of mean settling time, overshoot and steering effort.
+//
+// Usage:
+//		tuner [--threads n] [--grid n] [--steps n] [--timestep s] [--rules] [--engine] [--scaling]
+//
+// --grid		Points per axis of the centre width x inner peak partition sweep
+// --rules		Also try moving each rule's consequent one term up or down
+// --engine		Score with fl::Engine::process() instead of the compiled FlatController
+// --scaling	Instead of printing the front, score the candidates with 1, 2, 4... threads up to
+//				--threads (default every core) and print candidates/s and the speedup over 1 thread
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../source/Controller/engine_controller.h"
+#include "../source/Tuning/tuner.h"
+
+namespace
+{
+	struct Options
+	{
+		car::TuningSettings settings;
+		int grid = 3;
+		bool rules = false;
+		bool scaling = false;
+	};
+
+	bool ParseOptions(int _argc, char** _argv, Options& _options)
+	{
+		_options.settings.simulation.steps = 500;
+		_options.settings.simulation.timestep = 0.02;
+		for (int i = 1; i < _argc; ++i)
+		{
+			const std::string arg(_argv[i]);
+			if (arg == "--threads" && i + 1 < _argc)
+			{
+				_options.settings.threads = static_cast<unsigned>(std::atoi(_argv[++i]));
+			}
+			else if (arg == "--grid" && i + 1 < _argc)
+			{
+				_options.grid = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--steps" && i + 1 < _argc)
+			{
+				_options.settings.simulation.steps = std::atoi(_argv[++i]);
+			}
+			else if (arg == "--timestep" && i + 1 < _argc)
+			{
+				_options.settings.simulation.timestep = std::atof(_argv[++i]);
+			}
+			else if (arg == "--rules")
+			{
+				_options.rules = true;
+			}
+			else if (arg == "--engine")
+			{
+				_options.settings.exact_engine = true;
+			}
+			else if (arg == "--scaling")
+			{
+				_options.scaling = true;
+			}
+			else
+			{
+				std::cerr << "Usage: tuner [--threads n] [--grid n] [--steps n] [--timestep s] [--rules] [--engine] [--scaling]\n";
+				return false;
+			}
+		}
+		return _options.grid > 0 && _options.settings.simulation.steps > 0 && _options.settings.simulation.timestep > 0.0;
+	}
+
+	// Values spread evenly over [_min, _max]; a count of one uses the midpoint.
+	std::vector<double> Sweep(double _min, double _max, int _count)
+	{
+		std::vector<double> values;
+		for (int i = 0; i < _count; ++i)
+		{
+			values.push_back(_count == 1 ? 0.5 * (_min + _max) : _min + (_max - _min) * i / (_count - 1));
+		}
+		return values;
+	}
+
+	// Scaling
+	// Scores _candidates with 1, 2, 4... threads up to _options.settings.threads (every core if
+	// zero) and prints the throughput and speedup of each thread count over a single thread.
+	// OUT:		False if the thread counts disagree on any score
+	bool Scaling(const fl::Engine& _engine, const Options& _options, const std::vector<car::Candidate>& _candidates)
+	{
+		unsigned max_threads = _options.settings.threads;
+		if (max_threads == 0)
+		{
+			max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		std::vector<unsigned> thread_counts;
+		for (unsigned threads = 1; threads < max_threads; threads *= 2)
+		{
+			thread_counts.push_back(threads);
+		}
+		thread_counts.push_back(max_threads);
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "threads,seconds,candidates_per_second,speedup,efficiency\n";
+		std::vector<car::TuningResult> reference;
+		double single_rate = 0.0;
+		bool consistent = true;
+		for (const unsigned threads : thread_counts)
+		{
+			car::TuningSettings settings = _options.settings;
+			settings.threads = threads;
+			car::Tuner tuner(_engine, settings);
+			const auto start = std::chrono::steady_clock::now();
+			const std::vector<car::TuningResult> results = tuner.Evaluate(_candidates);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			const double rate = _candidates.size() / elapsed.count();
+			if (threads == 1)
+			{
+				single_rate = rate;
+				reference = results;
+			}
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				// Every candidate is scored on its own engine, so the thread count must not matter.
+				consistent = consistent && results[i].valid == reference[i].valid &&
+					results[i].score.settling_time == reference[i].score.settling_time &&
+					results[i].score.overshoot == reference[i].score.overshoot &&
+					results[i].score.effort == reference[i].score.effort;
+			}
+			std::cout << threads << ',' << elapsed.count() << ',' << rate << ',' << rate / single_rate << ','
+					  << rate / single_rate / threads << std::endl;
+		}
+		if (!consistent)
+		{
+			std::cerr << "Scores differ between thread counts." << std::endl;
+		}
+		return consistent;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<fl::Engine> engine;
+	try
+	{
+		engine.reset(car::BuildCarEngine());
+	}
+	catch (const fl::Exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// The unmodified controller is always scored, so the front shows whether anything beat it.
+	std::vector<car::Candidate> candidates(1);
+	candidates[0].name = "baseline";
+	const std::vector<car::Candidate> partitions = car::Tuner::PartitionSweep(*engine,
+		Sweep(0.1, 0.4, options.grid), Sweep(0.3, 0.7, options.grid));
+	candidates.insert(candidates.end(), partitions.begin(), partitions.end());
+	if (options.rules)
+	{
+		const std::vector<car::Candidate> neighbours = car::Tuner::RuleNeighbours(*engine);
+		candidates.insert(candidates.end(), neighbours.begin(), neighbours.end());
+	}
+
+	if (options.scaling)
+	{
+		return Scaling(*engine, options, candidates) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	car::Tuner tuner(*engine, options.settings);
+	const auto start = std::chrono::steady_clock::now();
+	const std::vector<car::TuningResult> results = tuner.Evaluate(candidates);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	for (const car::TuningResult& result : results)
+	{
+		if (!result.valid)
+		{
+			std::cerr << "Skipped " << result.candidate.name << ": " << result.error << std::endl;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(4);
+	std::cout << "settling_time,overshoot,effort,unsettled,candidate\n";
+	for (std::size_t index : car::Tuner::ParetoFront(results))
+	{
+		const car::TuningResult& result = results[index];
+		std::cout << result.score.settling_time << ',' << result.score.overshoot << ','
+				  << result.score.effort << ',' << result.score.unsettled << ','
+				  << result.candidate.name << '\n';
+	}
+
+	const double trajectories = static_cast<double>(candidates.size()) * car::Tuner::DefaultSuite().size();
+	std::cerr << candidates.size() << " candidates in " << elapsed.count() << " s ("
+			  << trajectories * options.settings.simulation.steps / elapsed.count() << " steps/s)" << std::endl;
+
+	return EXIT_SUCCESS;
+}